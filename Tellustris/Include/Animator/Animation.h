@@ -19,28 +19,45 @@ class Animation;
 using AnimationRef = Nz::ObjectRef<Animation>;
 using AnimationConstRef = Nz::ObjectRef<const Animation>;
 
+/* les frames ne sont modifiables que par les methodes de la classe,
+ * qui tiennent a jour la table des temps de fin cumules (recherche dichotomique de la frame courante)
+ * chaque modification change version(), les animators compiles avec l'ancienne version sont refaits
+ * */
 class Animation : public Nz::RefCounted, private std::vector<Frame>
 {
 public:
 	Animation(bool _loop = false);
 
-	using std::vector<Frame>::push_back;
-	using std::vector<Frame>::pop_back;
-	using std::vector<Frame>::begin;
-	using std::vector<Frame>::end;
-	using std::vector<Frame>::front;
-	using std::vector<Frame>::back;
-	using std::vector<Frame>::insert;
-	using std::vector<Frame>::erase;
-	using std::vector<Frame>::emplace_back;
-	using std::vector<Frame>::clear;
-	using std::vector<Frame>::operator [];
 	using std::vector<Frame>::size;
 	using std::vector<Frame>::empty;
 
+	const_iterator begin() const { return std::vector<Frame>::begin(); }
+	const_iterator end() const { return std::vector<Frame>::end(); }
+	const Frame & front() const { return std::vector<Frame>::front(); }
+	const Frame & back() const { return std::vector<Frame>::back(); }
+	const Frame & operator[](size_t index) const { return std::vector<Frame>::operator[](index); }
+
+	void push_back(const Frame & frame);
+	void pop_back();
+	void insert(size_t index, const Frame & frame);
+	void erase(size_t index);
+	void clear();
+	void setFrame(size_t index, const Frame & frame);
+
+	bool loop() const { return m_loop; }
+	void setLoop(bool loop);
+
+	//changed by each modification of the frames or of loop
+	unsigned int version() const { return m_version; }
+
 	float duration() const;
 	Nz::Recti bounds() const;
 
+	//frameEnds()[i] is the time at the end of the frame i
+	const std::vector<float> & frameEnds() const { return m_frameEnds; }
+	//time must be in [0;duration()], the last frame is returned after the end
+	size_t frameIndex(float time) const;
+
 	template<typename... Args> static AnimationRef New(Args&&... args)
 	{
 		auto object = std::make_unique<Animation>(std::forward<Args>(args)...);
@@ -49,7 +66,13 @@ public:
 		return object.release();
 	}
 
-	Frame current(float time, bool checkLoop = true);
+	const Frame & current(float time, bool checkLoop = true) const;
+
+private:
+	void updateFrameEnds(size_t from);
+	void changed();
 
-	bool loop = false;
+	std::vector<float> m_frameEnds;
+	bool m_loop = false;
+	unsigned int m_version = 0;
 };
\ No newline at end of file
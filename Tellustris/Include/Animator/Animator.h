@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Animator/Animation.h"
+#include "Animator/CompiledAnimator.h"
 #include "Utility/Expression/Expression.h"
 
 #include <Nazara/Core/RefCounted.hpp>
@@ -56,8 +57,8 @@ public:
 
 	bool animationExist(const std::string & name) const;
 	bool animationExist(unsigned int index) const;
-	AnimationRef animation(const std::string & name) const;
-	AnimationRef animation(unsigned int index) const;
+	const AnimationRef & animation(const std::string & name) const;
+	const AnimationRef & animation(unsigned int index) const;
 	void setAnimation(const std::string & name, AnimationRef animation);
 	void setAnimation(unsigned int index, AnimationRef animation);
 
@@ -90,8 +91,8 @@ public:
 	unsigned int getTransition(unsigned int fromState, unsigned int toState) const;
 
 	unsigned int transitionsCount() const;
-	std::vector<unsigned int> outStateTransitionsIndexs(const std::string & state) const;
-	std::vector<unsigned int> outStateTransitionsIndexs(unsigned int stateIndex) const;
+	const std::vector<unsigned int> & outStateTransitionsIndexs(const std::string & state) const;
+	const std::vector<unsigned int> & outStateTransitionsIndexs(unsigned int stateIndex) const;
 	std::vector<unsigned int> inStateTransitionsIndexs(const std::string & state) const;
 	std::vector<unsigned int> inStateTransitionsIndexs(unsigned int stateIndex) const;
 
@@ -99,10 +100,15 @@ public:
 	unsigned int transitionToStateIndex(unsigned int index) const;
 
 	std::string transitionConditionString(unsigned int index) const;
-	ConditionExpression transitionConditionExpression(unsigned int index) const;
+	const ConditionExpression & transitionConditionExpression(unsigned int index) const;
 	void setTransitionCondition(unsigned int index, const std::string & condition);
 	void setTransitionCondition(unsigned int index, const ConditionExpression & expression);
 
+	//the state machine read by the AnimatorComponents, built again on the first call after a change of the animator or of its animations
+	CompiledAnimatorConstRef compile() const;
+	//compile again on the next call, the AnimatorSystem gives the new state machine to the components
+	void invalidate();
+
 	template<typename... Args> static AnimatorRef New(Args&&... args)
 	{
 		auto object = std::make_unique<Animator>(std::forward<Args>(args)...);
@@ -115,4 +121,6 @@ private:
 	std::vector<AnimatorState> m_states;
 	std::vector<AnimatorTransition> m_transitions;
 	unsigned int m_defaultStateIndex = 0;
+
+	mutable CompiledAnimatorConstRef m_compiled;
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Animator/Animation.h"
+#include "Utility/Expression/Expression.h"
+
+#include <Nazara/Math/Vector3.hpp>
+#include <Nazara/Core/RefCounted.hpp>
+#include <Nazara/Core/ObjectRef.hpp>
+
+#include <vector>
+#include <string>
+
+class Animator;
+class CompiledAnimator;
+
+using CompiledAnimatorRef = Nz::ObjectRef<CompiledAnimator>;
+using CompiledAnimatorConstRef = Nz::ObjectRef<const CompiledAnimator>;
+
+/* machine a etats d'un Animator mise a plat, immuable une fois construite
+ * c'est tout ce que lisent les AnimatorComponent et l'AnimatorSystem a l'execution
+ * les frames sont copiees depuis les animations : Animator::compile la refait si la version d'une animation a change
+ * sourceRevision() change avec chaque animation ou animator modifie, l'AnimatorSystem donne alors aux composants leur nouvelle machine
+ * les proprietes lues par les conditions sont numerotees ici, apres les proprietes par defaut
+ * */
+class CompiledAnimator : public Nz::RefCounted
+{
+public:
+	using Condition = NExpression::Expression<int>;
+
+	struct State
+	{
+		size_t firstFrame;
+		size_t frameCount;
+		float duration;
+		bool loop;
+		bool xFlipped;
+		bool yFlipped;
+		bool alwaysEvaluated; //a condition calls rand or a user function, its value can change while the properties don't
+		size_t firstTransition;
+		size_t transitionCount;
+	};
+
+	//what a frame changes on a sprite, the texture rect is in texels with the flips of the state applied
+	struct SpriteFrame
+	{
+		Nz::Rectf textureRect;
+		Nz::Vector2f size;
+		Nz::Vector3f origin;
+	};
+
+	struct Transition
+	{
+		unsigned int nextState;
+		size_t firstSlot; //conditionSlots()[firstSlot + i] is the property read by the parameter i of the condition
+	};
+
+	//properties set by the AnimatorComponent, the first ones of every animator
+	static constexpr size_t propertyTime = 0; //total duration of the current state
+	static constexpr size_t propertyTimeSingle = 1; //duration on the animation, come back to 0 after each loop
+	static constexpr size_t propertyFinished = 2; //set to 1 when the animation is finished, not on loops
+	static constexpr size_t propertyLoop = 3; //loop count
+	static constexpr size_t defaultPropertyCount = 4;
+	static const char * const defaultPropertyNames[defaultPropertyCount];
+
+	CompiledAnimator(const Animator & animator);
+
+	size_t stateCount() const { return m_states.size(); }
+	unsigned int defaultState() const { return m_defaultState; }
+	const State & state(unsigned int index) const { return m_states[index]; }
+
+	//the transitions of a state are [firstTransition, firstTransition + transitionCount[, in the order they are tested
+	const Transition & transition(size_t index) const { return m_transitions[index]; }
+	const Condition & condition(size_t index) const { return m_conditions[index]; }
+	const std::vector<size_t> & conditionSlots() const { return m_conditionSlots; }
+
+	const std::vector<std::string> & propertyNames() const { return m_propertyNames; }
+	bool readsProperty(unsigned int state, size_t property) const;
+
+	const Frame & frame(const State & state, size_t index) const { return m_frames[state.firstFrame + index]; }
+	const SpriteFrame & spriteFrame(const State & state, size_t index) const { return m_spriteFrames[state.firstFrame + index]; }
+	//frameEnds(state)[i] is the time at the end of the frame i of the state
+	const float * frameEnds(const State & state) const { return m_frameEnds.data() + state.firstFrame; }
+	//first frame that ends after time, the last one after the end
+	static size_t frameIndex(const float * frameEnds, size_t frameCount, float time);
+
+	//an animation of the animator was modified since this one was built
+	bool isOutdated(const Animator & animator) const;
+
+	static unsigned int sourceRevision();
+	static void sourceChanged(); //called by the modifications of the animations and of the animators
+
+	template<typename... Args> static CompiledAnimatorRef New(Args&&... args)
+	{
+		auto object = std::make_unique<CompiledAnimator>(std::forward<Args>(args)...);
+		object->SetPersistent(false);
+
+		return object.release();
+	}
+
+private:
+	size_t propertyIndex(const std::string & name);
+
+	std::vector<State> m_states;
+	std::vector<Transition> m_transitions;
+	std::vector<Condition> m_conditions;
+	std::vector<size_t> m_conditionSlots;
+
+	std::vector<Frame> m_frames;
+	std::vector<SpriteFrame> m_spriteFrames;
+	std::vector<float> m_frameEnds;
+	std::vector<unsigned int> m_animationVersions; //version of the animation of each state, 0 without animation
+
+	std::vector<std::string> m_propertyNames;
+	std::vector<char> m_reads; //m_reads[state * m_propertyNames.size() + property]
+
+	unsigned int m_defaultState = 0;
+};
\ No newline at end of file
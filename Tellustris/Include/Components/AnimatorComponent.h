@@ -7,27 +7,35 @@
 
 #include <vector>
 
+class AnimatorSystem;
+
 class AnimatorComponent : public Ndk::Component<AnimatorComponent>
 {
-	struct PropertyValue
+	//a copy of the component is not in the system of the original
+	struct SystemSlot
 	{
-		std::string name;
-		int value;
+		SystemSlot() = default;
+		SystemSlot(const SystemSlot &) {}
+		SystemSlot & operator=(const SystemSlot &) { return *this; }
+
+		AnimatorSystem * system = nullptr;
+		size_t index = 0;
 	};
 
-	struct Transition
+	struct AttachedSprite
 	{
-		ConditionExpression expression;
-		unsigned int nextStateIndex;
+		Nz::SpriteRef sprite;
+		Nz::Vector2f invTextureSize; //read from the diffuse map when the sprite is attached
 	};
 
 public:
 	friend class AnimatorSystem;
 
 	AnimatorComponent();
+	~AnimatorComponent();
 
-	void attachAnimator(AnimatorRef animator);
-	void attachSprite(Nz::SpriteRef sprite);
+	void attachAnimator(AnimatorRef animator); //the properties read by the animator get the first indexs, the other indexs change
+	void attachSprite(Nz::SpriteRef sprite); //the texture of the sprite must be set before
 	bool detachSprite(Nz::SpriteRef sprite);
 	void detachAllSprite();
 
@@ -50,27 +58,35 @@ public:
 	static Ndk::ComponentIndex componentIndex;
 
 private:
-	void update(float elapsedTime);
+	bool updateTransitions(float stateTime, float animationTime); //return true if the state changed
 	void changeState(unsigned int nextState);
-	void addDefaultProperties();
-	void updateDefaultProperties();
-	void updateSprite();
+	void updateMachine(); //take the state machine compiled again after a change of the animator, the current state is kept if it still has frames
+	void bindProperties();
+	void updateSystemSlot();
+	void updateDefaultProperties(float stateTime, float animationTime);
+	void updateSprite(size_t frameIndex);
+	void updateSprite(const AttachedSprite & sprite, const CompiledAnimator::SpriteFrame & frame) const;
+	size_t currentFrame() const;
 
 	AnimatorRef m_animator;
-	std::vector<Nz::SpriteRef> m_sprites;
+	CompiledAnimatorConstRef m_machine; //the only part of the animator read while updating
+	std::vector<AttachedSprite> m_sprites;
+
+	//while the entity is in an AnimatorSystem, the times and the frame are only kept up to date in its arrays
+	SystemSlot m_slot;
 
 	unsigned int m_currentState = 0;
 	float m_stateTime = 0.f;
 	float m_animationTime = 0.f;
-	float m_animationDuration = 0.f;
-	std::vector<Transition> m_transitionExpressions;
+	size_t m_frame = 0;
 
-	std::vector<PropertyValue> m_properties;
+	//the conditions are only evaluated again when a property they read changes
+	bool m_conditionsDirty = true;
+	std::vector<int> m_conditionRegisters; //used by all the conditions, evaluated one after the other
+	std::vector<int> m_conditionArguments;
+
+	std::vector<std::string> m_propertyNames;
+	std::vector<int> m_propertyValues;
 	
 	float m_speed = 1;
-
-	size_t m_propertyTime = 0; //total duration of the current state
-	size_t m_propertyTimeSingle = 0; //duration on the animation, come back to 0 after each loop
-	size_t m_propertyFinished = 0; //property set to 1 when the animation is finished, not on loops
-	size_t m_propertyLoop = 0; //loop count
 };
\ No newline at end of file
@@ -3,24 +3,30 @@
 #include "GameData/Behaviours/Behaviour.h"
 #include "GameData/ContactArbiter2D.h"
 #include "Utility/Event/Events.h"
+#include "Utility/Event/EventChannel.h"
 
 #include <NDK/Component.hpp>
 
 #include <memory>
 #include <vector>
 
+class BehaviourSystem;
+
 class BehaviourComponent : public Ndk::Component<BehaviourComponent>
 {
+	friend class BehaviourSystem;
 public:
 	BehaviourComponent() = default;
 	BehaviourComponent(const BehaviourComponent & comp);
 	BehaviourComponent & operator=(const BehaviourComponent & comp);
+	~BehaviourComponent();
 
 	void attach(BehaviourRef behaviour);
 	void detach(size_t index);
 	void detachAll();
 
 	void update(float elapsedTime);
+	void start(); //call onStart on the behaviours attached since the last update
 
 	void onContactStart(ContactArbiter2D & arbiter, const Ndk::EntityHandle & otherBody);
 	void onContactEnd(ContactArbiter2D & arbiter, const Ndk::EntityHandle & otherBody);
@@ -39,8 +45,18 @@ public:
 		m_events.send(value);
 	}
 
+	//the values posted to the channel from any thread are sent to this component on the main thread
+	template <typename T>
+	std::unique_ptr<EventChannel<T>> createChannel()
+	{
+		return std::make_unique<EventChannel<T>>([this](const T & value) {send(value); });
+	}
+
 	static Ndk::ComponentIndex componentIndex;
 private:
+	static void initBehaviour(Behaviour & behaviour);
+	void setHaveNewBehaviours();
+
 	void OnAttached() override;
 	void OnComponentAttached(Ndk::BaseComponent& component) override;
 	void OnComponentDetached(Ndk::BaseComponent& component) override;
@@ -50,6 +66,8 @@ private:
 	void OnEntityEnabled() override;
 
 	bool m_haveEntity = false;
+	bool m_haveNewBehaviours = false;
+	BehaviourSystem * m_system = nullptr; //the behaviours are in its update lists
 
 	std::vector<BehaviourRef> m_behaviours;
 
@@ -22,6 +22,7 @@ class TilemapAnimationComponent : public Ndk::Component<TilemapAnimationComponen
 		TileAnimationExpression expression;
 	};
 
+	//animation started by playAnimation, played once over the tile
 	struct PlayingAnimation
 	{
 		size_t animationIndex;
@@ -29,7 +30,21 @@ class TilemapAnimationComponent : public Ndk::Component<TilemapAnimationComponen
 		size_t y;
 		size_t currentFrameIndex;
 		float delay;
-		bool overWrite;
+	};
+
+	/* animation en boucle d'une tile de la map, sans etat : sa frame est (temps - delay) / frameTime
+	 * les tiles sont rangees dans la roue selon le moment de leurs changements de frame dans une periode frameTime,
+	 * une mise a jour ne visite que les cases de la roue passees depuis la precedente
+	 * */
+	struct AnimatedTile
+	{
+		unsigned int x;
+		unsigned int y;
+		unsigned int animationIndex; //TilemapAnimations::animation(size_t), not a tile id
+		float delay;
+		unsigned int bucket;
+		unsigned int bucketIndex; //index in m_wheel[bucket]
+		bool overWrite; //a PlayingAnimation is played on the tile
 	};
 
 public:
@@ -50,18 +65,36 @@ public:
 
 	static Ndk::ComponentIndex componentIndex;
 
+	static constexpr unsigned int wheelSize = 32; //the frames change at most frameTime / wheelSize late
+	static constexpr unsigned int noTile = static_cast<unsigned int>(-1);
+
 private:
 	void onTilemapUpdate(size_t x, size_t y);
 	void onAnimationUpdate();
 
 	void updateAnimations();
-	void addTile(size_t x, size_t y, std::vector<PlayingAnimation> & vect, unsigned int tile);
-	void updateFrame(PlayingAnimation & a, const std::vector<Nz::Vector2ui> & renderersSize, float fTime, unsigned int tileSize, unsigned int tileDelta, float delay);
+	void addTile(size_t x, size_t y, unsigned int tile);
+	void computeDelays(size_t animationIndex, const std::vector<float> & xs, const std::vector<float> & ys, std::vector<float> & delays) const;
+	void insertAnimatedTile(size_t x, size_t y, size_t animationIndex, float delay);
+	void removeAnimatedTile(size_t x, size_t y);
+	unsigned int animatedTileIndex(size_t x, size_t y) const;
+	unsigned int playingAnimationIndex(size_t x, size_t y) const;
+	void removePlayingAnimation(unsigned int index);
+	void updateWheel(float previousTime, float fTime);
+	void updateAnimatedTile(const AnimatedTile & tile, float fTime);
+	void updateFrame(PlayingAnimation & a, float fTime);
 	void removeFrame(size_t x, size_t y);
+	void drawTile(size_t x, size_t y, unsigned int tileID);
 
 	float m_time;
-	std::vector<PlayingAnimation> m_playingAnimations;
+	std::vector<AnimatedTile> m_animatedTiles;
+	std::vector<unsigned int> m_animatedTileIndexs; //index in m_animatedTiles of the tile at x + y * width, noTile if it is not animated
+	std::vector<std::vector<unsigned int>> m_wheel;
+	std::vector<unsigned int> m_refreshedTiles; //x + y * width of the animated tiles drawn on the next update
+	bool m_refreshAll = false;
 	std::vector<PlayingAnimation> m_tempPlayingAnimations;
+	std::vector<unsigned int> m_playingAnimationIndexs; //index in m_tempPlayingAnimations of the animation played at x + y * width, noTile if none
+	std::vector<Nz::Vector2ui> m_rendererSizes;
 
 	TilemapRef m_tilemap;
 	TilemapAnimationsRef m_tileAnimations;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "GameData/ContactArbiter2D.h"
+#include "GameData/Behaviours/BehaviourAccess.h"
+#include "Utility/MemoryPool.h"
 #include "Utility/Event/Events.h"
 
 #include <NDK/Entity.hpp>
@@ -11,9 +13,11 @@
 class Behaviour;
 using BehaviourRef = std::unique_ptr<Behaviour>;
 
+//the concrete behaviours also derive from PoolAllocated, clone and the creators allocate them from their pool
 class Behaviour
 {
 	friend class BehaviourComponent;
+	friend class BehaviourSystem;
 public:
 	Behaviour() = default;
 	virtual ~Behaviour() = default;
@@ -30,7 +34,14 @@ protected:
 	virtual void onEnable() {}
 	virtual void onDisable() {}
 	virtual void onDestroy() {}
-	virtual void onUpdate(float deltaTime) {}
+	//the BehaviourSystem stops updating the types that don't override onUpdate, it must not be called by the overrides
+	virtual void onUpdate(float deltaTime) { m_updateOverridden = false; }
+
+	/* read once, when the behaviour is attached
+	 * the behaviours not updated on the main thread must not send events, except through an EventChannel
+	 * */
+	virtual BehaviourThreading threading() const { return BehaviourThreading::mainThread; }
+	virtual void declareAccess(BehaviourAccess & access) const {}
 
 	virtual void OnEntityComponentAttached(Ndk::BaseComponent& component) {}
 	virtual void OnEntityComponentDetached(Ndk::BaseComponent& component) {}
@@ -54,4 +65,13 @@ private:
 	Ndk::EntityHandle m_entity;
 	size_t m_index;
 	bool m_started = false;
+	BehaviourThreading m_threading = BehaviourThreading::mainThread;
+	BehaviourAccess m_access;
+
+	//place in the update lists of the BehaviourSystem
+	size_t m_updateType = noUpdateType;
+	size_t m_updateIndex = 0;
+	bool m_updateOverridden = true;
+
+	static constexpr size_t noUpdateType = static_cast<size_t>(-1);
 };
\ No newline at end of file
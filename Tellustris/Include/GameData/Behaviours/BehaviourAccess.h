@@ -0,0 +1,34 @@
+#pragma once
+
+#include <NDK/Algorithm.hpp>
+
+#include <vector>
+
+enum class BehaviourThreading
+{
+	mainThread, //onUpdate is called on the thread of the world, after the other behaviours
+	entity, //onUpdate only uses its own entity and its own members, the instances of a type are updated in parallel
+	access, //onUpdate uses the component types declared by declareAccess, on any entity
+};
+
+//component types read and written by the onUpdate of a behaviour, on all the entities
+class BehaviourAccess
+{
+public:
+	template <typename T>
+	void read() { add(m_reads, Ndk::GetComponentIndex<T>()); }
+	template <typename T>
+	void write() { add(m_writes, Ndk::GetComponentIndex<T>()); }
+
+	//true if the two behaviours can't run at the same time
+	bool conflicts(const BehaviourAccess & other) const;
+	void merge(const BehaviourAccess & other);
+	void clear();
+
+private:
+	static void add(std::vector<Ndk::ComponentIndex> & indexs, Ndk::ComponentIndex index);
+	static bool intersects(const std::vector<Ndk::ComponentIndex> & a, const std::vector<Ndk::ComponentIndex> & b);
+
+	std::vector<Ndk::ComponentIndex> m_reads; //sorted
+	std::vector<Ndk::ComponentIndex> m_writes; //sorted
+};
\ No newline at end of file
@@ -2,15 +2,29 @@
 
 #include "Behaviour.h"
 #include "GameData/Chunk.h"
+#include "Tilemap/ColliderMerger.h"
 
 #include <NDK/Entity.hpp>
+#include <Nazara/Physics2D/Collider2D.hpp>
 
-class ChunkCollisionBehaviour : public Behaviour
+#include <array>
+
+/* une entite de collision par collision layer, avec un collider compose
+ * les colliders ne traversent pas les bandes de bandSize lignes : un changement de tile
+ * ne reconstruit que les colliders de sa bande, les autres sont reutilises tels quels
+ * */
+class ChunkCollisionBehaviour : public Behaviour, public PoolAllocated<ChunkCollisionBehaviour>
 {
+	static constexpr size_t bandSize = 8;
+	static constexpr size_t bandCount = (Chunk::chunkSize + bandSize - 1) / bandSize;
+
 	struct ColliderLayer
 	{
 		unsigned int id;
 		Ndk::EntityHandle entity;
+		ColliderMerger merger;
+		std::array<std::vector<Nz::Collider2DRef>, bandCount> bands;
+		unsigned int dirtyBands;
 	};
 
 public:
@@ -21,20 +35,29 @@ public:
 protected:
 	void onEnable() override;
 	void onDisable() override;
+	void onUpdate(float deltaTime) override; //the changes of the frame are applied at once
 
 private:
-	void updateCollisions();
+	void onLayerChange(size_t layer, Chunk::LayerChanged::ChangeState state);
+	void onMapChange(size_t x, size_t y);
+
+	void rescan(); //all the tiles, after a change of the layers
+	void updateTile(size_t x, size_t y);
+	void addTile(size_t x, size_t y);
+	void flush();
+	void rebuildBand(ColliderLayer & layer, size_t band);
+	void updateGeom(ColliderLayer & layer);
 	void clearCollisions();
 
-	void createCollisionLayer(unsigned int collisionLayer);
+	ColliderLayer & collisionLayer(unsigned int id);
 	Ndk::EntityHandle createEntity();
 
-	bool haveFullCollision(size_t x, size_t y, unsigned int collisionLayer) const;
-
 	Chunk & m_chunk;
 
 	EventHolder<Chunk::LayerChanged> m_layerChangedHolder;
 	std::vector<EventHolder<Tilemap::TilemapModified>> m_mapModified;
 
 	std::vector<ColliderLayer> m_layers;
+	std::vector<Nz::Collider2DRef> m_colliders; //all the bands of a layer, kept for its memory
+	bool m_dirty = false;
 };
\ No newline at end of file
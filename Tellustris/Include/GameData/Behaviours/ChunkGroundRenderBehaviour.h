@@ -13,7 +13,7 @@
 
 class WorldRenderBehaviour;
 
-class ChunkGroundRenderBehaviour : public Behaviour
+class ChunkGroundRenderBehaviour : public Behaviour, public PoolAllocated<ChunkGroundRenderBehaviour>
 {
 	struct TilemapInfos
 	{
@@ -13,7 +13,7 @@
 
 class WorldRenderBehaviour;
 
-class ChunkRenderBehaviour : public Behaviour
+class ChunkRenderBehaviour : public Behaviour, public PoolAllocated<ChunkRenderBehaviour>
 {
 	struct TilemapInfos
 	{
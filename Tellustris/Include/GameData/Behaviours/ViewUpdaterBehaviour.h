@@ -4,7 +4,7 @@
 
 #include <NDK/Components/NodeComponent.hpp>
 
-class ViewUpdaterBehaviour : public Behaviour
+class ViewUpdaterBehaviour : public Behaviour, public PoolAllocated<ViewUpdaterBehaviour>
 {
 public:
 	BehaviourRef clone() const override;
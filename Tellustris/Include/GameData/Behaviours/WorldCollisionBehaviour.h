@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Behaviour.h"
+#include "Utility/Event/Event.h"
+#include "Utility/Event/Args.h"
+#include "GameData/WorldMap.h"
+#include "Tilemap/ColliderMerger.h"
+
+#include <NDK/Entity.hpp>
+#include <Nazara/Math/Rect.hpp>
+
+#include <vector>
+#include <memory>
+
+/* remplace les ChunkCollisionBehaviour des chunks autour de la vue
+ * les rectangles de collision pleine sont fusionnes entre les chunks charges, en coordonnees de tiles du monde
+ * une forme appartient au chunk de son coin haut gauche, qui porte son collider
+ * une modification ne refait que les formes qui touchent les tiles modifiees (ou leurs voisines),
+ * un dechargement coupe les formes qui debordaient sur le chunk
+ * les tiles partielles restent fusionnees chunk par chunk
+ * */
+class WorldCollisionBehaviour : public Behaviour, public PoolAllocated<WorldCollisionBehaviour>
+{
+	struct Shape
+	{
+		Nz::Recti rect; //world tiles
+		Nz::Vector2i owner; //world chunk
+	};
+
+	struct CollisionLayer
+	{
+		unsigned int id;
+		std::vector<Shape> shapes;
+	};
+
+	struct ChunkLayer
+	{
+		unsigned int id;
+		Ndk::EntityHandle entity;
+		ColliderMerger tiles;
+		bool geomDirty;
+	};
+
+	//kept by pointer, the events of the chunk point to it
+	struct ChunkInfo
+	{
+		Chunk & chunk;
+		int x;
+		int y;
+		std::vector<ChunkLayer> layers;
+		bool needRescan;
+		EventHolder<Chunk::LayerChanged> layerChangedHolder;
+		std::vector<EventHolder<Tilemap::TilemapModified>> mapModified;
+	};
+
+public:
+	WorldCollisionBehaviour(WorldMap & map, float viewSize);
+	BehaviourRef clone() const override;
+
+protected:
+	void onEnable() override;
+	void onDisable() override;
+	void onUpdate(float deltaTime) override; //the changes of the frame are applied at once
+
+private:
+	void onCenterViewUpdate(float x, float y);
+	void onLayerChange(ChunkInfo & info, size_t layer, Chunk::LayerChanged::ChangeState state);
+	void onMapChange(ChunkInfo & info, size_t x, size_t y);
+
+	void addChunk(int x, int y);
+	void removeChunk(size_t index);
+	void rescan(ChunkInfo & info);
+	void updateTile(ChunkInfo & info, size_t x, size_t y);
+	void addTile(ChunkInfo & info, size_t x, size_t y);
+
+	void flush();
+	void rebuildShapes(CollisionLayer & layer);
+	void addFreeTiles(ColliderMerger & merger, const Nz::Recti & box, const Nz::Recti & rect, unsigned int id);
+	void updateGeom(ChunkInfo & info, ChunkLayer & layer);
+
+	ChunkInfo * chunkInfo(int x, int y);
+	ChunkLayer * chunkLayer(ChunkInfo & info, unsigned int id);
+	ChunkLayer & createChunkLayer(ChunkInfo & info, unsigned int id);
+	CollisionLayer & collisionLayer(unsigned int id);
+	Ndk::EntityHandle createEntity(int chunkX, int chunkY);
+	std::vector<Nz::Vector2i> getViewChunks(float x, float y) const;
+	static Nz::Recti chunkRect(int chunkX, int chunkY);
+
+	EventHolder<CenterViewUpdate> m_centerViewUpdateHolder;
+	WorldMap & m_map;
+	float m_viewSize;
+
+	std::vector<std::unique_ptr<ChunkInfo>> m_chunks;
+	std::vector<CollisionLayer> m_layers;
+
+	//world tiles to rebuild, and the chunks unloaded since the last flush
+	std::vector<Nz::Recti> m_dirtyRects;
+	std::vector<Nz::Recti> m_unloadedRects;
+	bool m_dirty = false;
+
+	//kept for their memory
+	std::vector<Shape> m_removedShapes;
+	std::vector<Nz::Recti> m_rects;
+	std::vector<Nz::Collider2DRef> m_colliders;
+};
\ No newline at end of file
@@ -13,7 +13,7 @@
 class ChunkRenderBehaviour;
 class ChunkGroundRenderBehaviour;
 
-class WorldRenderBehaviour : public Behaviour
+class WorldRenderBehaviour : public Behaviour, public PoolAllocated<WorldRenderBehaviour>
 {
 	struct ChunkInfo
 	{
@@ -58,11 +58,14 @@ protected:
 
 private:
 	void onCenterViewUpdate(float x, float y);
+	void onChunksGenerated(const std::vector<Nz::Vector2ui> & chunks);
+	void updateBorder(const ChunkInfo & chunk, int dx, int dy); //the tiles of chunk next to its neighbour (chunk.x + dx, chunk.y + dy)
 	void addChunk(int x, int y);
 	void removeChunk(size_t index); 
 	std::vector<Nz::Vector2i> getViewChunks(float x, float y) const;
 
 	EventHolder<CenterViewUpdate> m_CenterViewUpdateHolder;
+	EventHolder<WorldMap::ChunksGenerated> m_chunksGeneratedHolder;
 	TileDefinitionRef m_definition;
 	WorldMap & m_map;
 	float m_viewSize;
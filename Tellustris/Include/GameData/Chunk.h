@@ -2,6 +2,7 @@
 
 #include "Tilemap/Tilemap.h"
 #include "Utility/Event/Event.h"
+#include "Utility/MemoryPool.h"
 
 #include <Nazara/Core/RefCounted.hpp>
 #include <Nazara/Core/ObjectRef.hpp>
@@ -13,7 +14,7 @@ class Chunk;
 using ChunkRef = Nz::ObjectRef<Chunk>;
 using ChunkConstRef = Nz::ObjectRef<const Chunk>;
 
-class Chunk : public Nz::RefCounted
+class Chunk : public Nz::RefCounted, public PoolAllocated<Chunk>
 {
 	struct TilemapLayer
 	{
@@ -46,6 +47,8 @@ public:
 
 	Tile getTile(size_t x, size_t y, size_t layer) const;
 	void setTile(size_t x, size_t y, Tile tile, size_t layer);
+	//bulk version of setTile, tiles must be chunkSize x chunkSize
+	void setLayer(size_t layer, const Matrix<Tile> & tiles);
 	TilemapRef getMap(size_t layer);
 	bool haveLayer(size_t layer) const;
 	void setLayerHeight(size_t layer, float height);
@@ -64,8 +67,9 @@ public:
 
 private:
 	static bool tilesEqual(const Tile & t1, const Tile & t2);
+	static TilemapRef createTilemap();
 
-	std::vector<TilemapLayer> m_tilemaps;
+	std::vector<TilemapLayer, PoolAllocator<TilemapLayer>> m_tilemaps;
 
 	Event<LayerChanged> m_event;
 };
\ No newline at end of file
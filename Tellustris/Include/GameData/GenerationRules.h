@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GameData/WorldGenerator.h"
+
+#include <Nazara/Core/RefCounted.hpp>
+#include <Nazara/Core/ObjectRef.hpp>
+
+#include <string>
+#include <vector>
+
+class GenerationRules;
+
+using GenerationRulesRef = Nz::ObjectRef<GenerationRules>;
+using GenerationRulesConstRef = Nz::ObjectRef<const GenerationRules>;
+
+/* regles de generation du monde, chargees depuis un .gdef
+ * les bruits sont evalues sur toute la grille du chunk, puis les variables dans l'ordre de declaration,
+ * une expression peut utiliser x, y (position de la tile dans le monde), les bruits et les variables precedentes
+ * pour chaque couche, le premier materiau dont la condition est vraie est utilise
+ *
+ * the parser has no usual precedence, the conditions must be bracketed :
+ * "(height < 0) && (abs(height) < 0.1)"
+ * */
+class GenerationRules : public Nz::RefCounted
+{
+public:
+	enum class NoiseType
+	{
+		Perlin,
+		Simplex,
+	};
+
+	struct Noise
+	{
+		std::string name;
+		NoiseType type = NoiseType::Perlin;
+		float amplitude = 1;
+		size_t frequence = 1;
+		size_t seed = 0;
+	};
+
+	struct Variable
+	{
+		std::string name;
+		std::string expression;
+	};
+
+	struct Material
+	{
+		unsigned int id = 0;
+		size_t layer = 0;
+		std::string condition;
+	};
+
+	void addNoise(const Noise & noise);
+	void addNoise(const std::string & name, NoiseType type, float amplitude, size_t frequence, size_t seed);
+	void addVariable(const std::string & name, const std::string & expression);
+	void addMaterial(unsigned int id, size_t layer, const std::string & condition);
+
+	const std::vector<Noise> & noises() const { return m_noises; }
+	const std::vector<Variable> & variables() const { return m_variables; }
+	const std::vector<Material> & materials() const { return m_materials; }
+
+	//false if an expression can't be parsed or reads a name that is not x, y, a noise or a previous variable
+	bool check(std::string & error) const;
+
+	//the rules are parsed and compiled once, the noises are periodic on worldSize tiles
+	//the returned function can be used from all the generator threads, the rules must pass check
+	WorldGenerator::GenerationFunction compile(size_t worldSize) const;
+
+	template<typename... Args> static GenerationRulesRef New(Args&&... args)
+	{
+		auto object = std::make_unique<GenerationRules>(std::forward<Args>(args)...);
+		object->SetPersistent(false);
+
+		return object.release();
+	}
+
+private:
+	std::vector<Noise> m_noises;
+	std::vector<Variable> m_variables;
+	std::vector<Material> m_materials;
+};
@@ -14,4 +14,5 @@ private:
 
 	static bool loadTileDefinition(const std::string & path, const std::string & filename);
 	static bool loadCollisionDefinition(const std::string & path, const std::string & filename);
+	static bool loadGenerationRules(const std::string & path, const std::string & filename);
 };
\ No newline at end of file
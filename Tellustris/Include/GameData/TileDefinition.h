@@ -2,6 +2,7 @@
 
 #include "TileConnexionType.h"
 #include "Utility/FixedMatrix.h"
+#include "Utility/MemoryPool.h"
 
 #include <Nazara/Core/RefCounted.hpp>
 #include <Nazara/Core/ObjectRef.hpp>
@@ -35,7 +36,7 @@ struct TileMaterialDefinition
 	std::vector<TileMaterialLayers> allowedLayers;
 };
 
-class TileDefinition : public Nz::RefCounted
+class TileDefinition : public Nz::RefCounted, public PoolAllocated<TileDefinition>
 {
 public:
 	size_t addTexture(Nz::TextureRef texture);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Tilemap/Tile.h"
+#include "Utility/Matrix.h"
+#include "Utility/ThreadPool.h"
+
+#include <Nazara/Math/Vector2.hpp>
+
+#include <functional>
+#include <vector>
+
+/* genere les chunks en parallele sur un ThreadPool, un chunk par tache
+ * la fonction de generation remplit les couches d'un chunk sans toucher au WorldMap,
+ * c'est le WorldMap qui ecrit ensuite les resultats dans ses chunks depuis le thread principal
+ * */
+class WorldGenerator
+{
+public:
+	//one chunkSize x chunkSize matrix per layer, starting at layer 0
+	using ChunkLayers = std::vector<Matrix<Tile>>;
+	//called from the pool threads, must be thread safe
+	//(chunkX, chunkY) is the chunk position in the map, the world tile of (0, 0) is chunkX * Chunk::chunkSize, chunkY * Chunk::chunkSize
+	using GenerationFunction = std::function<void(size_t chunkX, size_t chunkY, ChunkLayers & layers)>;
+
+	WorldGenerator(GenerationFunction function, ThreadPool & pool = ThreadPool::global());
+
+	std::vector<ChunkLayers> generate(const std::vector<Nz::Vector2ui> & chunks) const;
+
+private:
+	GenerationFunction m_function;
+	ThreadPool & m_pool;
+};
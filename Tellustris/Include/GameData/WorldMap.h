@@ -1,13 +1,22 @@
 #pragma once
 
 #include "Chunk.h"
+#include "WorldGenerator.h"
 #include "Utility/Matrix.h"
+#include "Utility/Event/Event.h"
 
 #include <vector>
+#include <memory>
 
 class WorldMap
 {
 public:
+	//sent once per generateChunks, after all the chunks of the batch are written
+	struct ChunksGenerated
+	{
+		std::vector<Nz::Vector2ui> chunks; //definition chunk coordinates
+	};
+
 	WorldMap(size_t chunksX, size_t chunksY);
 	WorldMap(const WorldMap &) = delete;
 	WorldMap & operator=(const WorldMap &) = delete;
@@ -21,6 +30,15 @@ public:
 	Tile getTile(int x, int y, size_t layer) const;
 	void setTile(int x, int y, Tile tile, size_t layer);
 	Matrix<Tile> getTiles(int x, int y, int width, int height, size_t layer) const;
+
+	//with a generator, chunks are generated the first time they are requested by the non const getChunk or setTile
+	void setGenerator(std::unique_ptr<WorldGenerator> generator);
+	bool isGenerated(int x, int y) const;
+	//world chunk coordinates, the missing chunks are generated together on the generator pool
+	void generateChunks(const std::vector<Nz::Vector2i> & chunks);
+	void generateAll();
+
+	EventHolder<ChunksGenerated> registerChunksGeneratedCallback(std::function<void(const ChunksGenerated &)> callback) { return m_event.connect(callback); }
 	
 	//world tile coordinate to definition chunk coordinate
 	Nz::Vector2ui posToChunkPos(const Nz::Vector2f & pos) const;
@@ -54,4 +72,8 @@ private:
 	size_t m_width;
 	size_t m_height;
 	std::vector<ChunkRef> m_chunks;
+
+	std::unique_ptr<WorldGenerator> m_generator;
+	std::vector<bool> m_generated;
+	Event<ChunksGenerated> m_event;
 };
\ No newline at end of file
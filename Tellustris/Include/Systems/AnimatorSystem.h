@@ -2,13 +2,51 @@
 
 #include <NDK/System.hpp>
 
+#include <vector>
+
+class AnimatorComponent;
+
+/* l'etat de lecture des animators est range en tableaux, une case par entite
+ * le temps avance sur des blocs de cases contigues, puis les conditions et les frames sont calculees sur le meme bloc,
+ * les blocs sont repartis sur le ThreadPool, un bloc n'ecrit que dans ses cases et ses composants
+ * les etats dont une condition appelle rand ou une fonction utilisateur sont evalues apres, sur le thread du monde
+ * les sprites sont mis a jour ensuite sur le thread du monde, seulement quand la frame change
+ * */
 class AnimatorSystem : public Ndk::System<AnimatorSystem>
 {
+	friend class AnimatorComponent;
+
 public:
 	AnimatorSystem();
 
 	static Ndk::SystemIndex systemIndex;
 
+	static constexpr size_t blockSize = 256;
+	static constexpr size_t noFrame = static_cast<size_t>(-1);
+
 protected:
 	virtual void OnUpdate(float elapsedTime) override;
+	virtual void OnEntityAdded(Ndk::Entity * entity) override;
+	virtual void OnEntityRemoved(Ndk::Entity * entity) override;
+
+private:
+	void removeComponent(AnimatorComponent & component); //free the slot of the component, swapped with the last one
+	void updateBlock(size_t begin, size_t end, float elapsedTime);
+	void updateFrame(size_t slot); //test the transitions of the slot, then find its frame
+	void load(size_t slot); //copy the state of the component of the slot
+	void store(size_t slot); //copy back the times and the frame to the component
+
+	std::vector<AnimatorComponent *> m_components;
+	std::vector<const float *> m_frameEnds; //frame end times of the current state, in the compiled animator
+	std::vector<size_t> m_frameCounts; //0 without animator
+	std::vector<float> m_durations;
+	std::vector<char> m_loops;
+	std::vector<float> m_speeds;
+	std::vector<float> m_stateTimes;
+	std::vector<float> m_animationTimes;
+	std::vector<size_t> m_frames;
+	std::vector<size_t> m_shownFrames; //frame of the current state shown by the sprites, noFrame after a change of state
+	std::vector<char> m_impureConditions; //the current state has a condition that isn't pure, updated out of the blocks
+	std::vector<size_t> m_impureSlots; //slots with m_impureConditions when the update starts
+	unsigned int m_sourceRevision = 0; //CompiledAnimator::sourceRevision when the components last took their state machine
 };
\ No newline at end of file
@@ -1,14 +1,72 @@
 #pragma once
 
+#include "GameData/Behaviours/BehaviourAccess.h"
+
 #include <NDK/System.hpp>
 
+#include <vector>
+#include <map>
+#include <typeindex>
+
+class BehaviourComponent;
+class Behaviour;
+
+/* les behaviours sont ranges par type concret (et par threading), les instances d'un type sont mises a jour a la suite
+ * un type qui ne redefinit pas onUpdate est retire des listes apres son premier appel
+ * - les types BehaviourThreading::entity, les instances d'un type sont reparties sur le ThreadPool
+ * - les behaviours BehaviourThreading::access, en lots dont les acces ne se chevauchent pas, un lot apres l'autre
+ *   les lots ne sont refaits que quand ces behaviours changent. Les instances d'un type qui ecrivent un composant
+ *   sont en conflit entre elles : elles sont mises a jour a la suite, dans une seule tache de leur lot
+ * - les types BehaviourThreading::mainThread, sur le thread du monde
+ * les onStart des behaviours ajoutes depuis la derniere mise a jour sont appeles avant, sur le thread du monde
+ * */
 class BehaviourSystem : public Ndk::System<BehaviourSystem>
 {
+	friend class BehaviourComponent;
+
 public:
 	BehaviourSystem();
 
 	static Ndk::SystemIndex systemIndex;
 
+	static constexpr size_t grain = 16;
+
 protected:
 	virtual void OnUpdate(float elapsedTime) override;
+	virtual void OnEntityAdded(Ndk::Entity * entity) override;
+	virtual void OnEntityRemoved(Ndk::Entity * entity) override;
+
+private:
+	struct UpdateType
+	{
+		BehaviourThreading threading;
+		bool updates = true; //false once an instance called Behaviour::onUpdate
+		bool haveRemoved = false; //null pointers left by a remove while updating
+		std::vector<Behaviour *> behaviours;
+	};
+
+	struct AccessBatch
+	{
+		BehaviourAccess access;
+		std::vector<Behaviour *> behaviours;
+		std::vector<size_t> sequentialTypes; //indexs in m_types, all the instances of the type in the same task
+	};
+
+	void addBehaviour(BehaviourComponent & component, Behaviour & behaviour);
+	void removeBehaviour(Behaviour & behaviour);
+	void removeComponent(BehaviourComponent & component);
+	void startLater(BehaviourComponent & component);
+
+	void buildAccessBatches();
+	void cleanTypes();
+
+	std::map<std::pair<std::type_index, BehaviourThreading>, size_t> m_typeIndexs;
+	std::vector<UpdateType> m_types;
+	std::vector<BehaviourComponent *> m_startingComponents; //with behaviours not started yet
+	std::vector<AccessBatch> m_batches; //kept between the updates for their memory, only the m_batchCount first are used
+	size_t m_batchCount = 0;
+	bool m_batchesDirty = false; //an access behaviour was added or removed since the batches were built
+	bool m_updating = false;
+
+	static constexpr size_t notListed = static_cast<size_t>(-1);
 };
\ No newline at end of file
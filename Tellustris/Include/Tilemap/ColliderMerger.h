@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Tilemap/Tile.h"
+
+#include <Nazara/Physics2D/Collider2D.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/* fusionne les colliders des tiles d'une meme collision layer
+ * les tiles pleines sont gardees en masques de bits, 32 tiles par masque, et couvertes de rectangles
+ * par un glouton sur les bits : le plus long segment de la premiere ligne libre, etendu vers le bas
+ * les tiles partielles rectangulaires qui touchent les deux bords de la tile sur un axe
+ * (Half, CentredHalf) et se suivent sur cet axe avec la meme forme donnent un seul rectangle
+ * */
+class ColliderMerger
+{
+	using Row = uint32_t;
+	static constexpr size_t rowBits = sizeof(Row) * 8;
+
+	struct PartialTile
+	{
+		unsigned int x;
+		TileCollider collider;
+	};
+
+	struct PartialShape
+	{
+		unsigned int value; //TileCollider::toInt, the same shape in the same layer
+		unsigned int major; //the column of a vertical strip, the line of an horizontal strip
+		unsigned int minor; //position along the strip
+		bool vertical;
+		Nz::Rectf rect;
+	};
+
+public:
+	ColliderMerger(size_t width = 0, size_t height = 0);
+
+	void resize(size_t width, size_t height); //all the tiles are removed
+	void clear();
+
+	void addTile(size_t x, size_t y, const TileCollider & collider); //the tile can hold several colliders
+	void removeTile(size_t x, size_t y);
+	bool haveTile(size_t x, size_t y) const;
+	bool haveFullTile(size_t x, size_t y) const;
+	bool empty() const;
+
+	//add the colliders of the rows [beginRow;endRow[ to colliders, nothing is merged across these bounds
+	void merge(std::vector<Nz::Collider2DRef> & colliders, const Nz::Vector2f & tileSize, size_t beginRow = 0, size_t endRow = size_t(-1)) const;
+	//the two parts of merge : the rectangles of the full tiles, in tiles, and the colliders of the partial tiles
+	void fullRects(std::vector<Nz::Recti> & rects, size_t beginRow = 0, size_t endRow = size_t(-1)) const;
+	void mergePartials(std::vector<Nz::Collider2DRef> & colliders, const Nz::Vector2f & tileSize, size_t beginRow = 0, size_t endRow = size_t(-1)) const;
+
+private:
+
+	size_t m_width;
+	size_t m_height;
+	size_t m_rowSize; //masks per row
+
+	std::vector<Row> m_full;
+	std::vector<std::vector<PartialTile>> m_partials; //by row
+
+	//kept for their memory
+	mutable std::vector<Row> m_rows;
+	mutable std::vector<Nz::Recti> m_rects;
+	mutable std::vector<PartialShape> m_shapes;
+};
\ No newline at end of file
@@ -36,7 +36,8 @@ struct TileCollider
 	bool haveCollision() const;
 	bool haveFullCollision() const;
 
-	Nz::Collider2DRef toCollider(const Nz::Vector2f & pos, const Nz::Vector2f & size);
+	Nz::Collider2DRef toCollider(const Nz::Vector2f & pos, const Nz::Vector2f & size) const;
+	bool toRect(Nz::Rectf & rect) const; //false if the shape is not an axis aligned rectangle, else the rectangle in the [0;1] space of the tile
 
 	TileColliderType type;
 	TileColliderRotation rotation;
@@ -45,7 +46,18 @@ struct TileCollider
 	unsigned int collisionLayer;
 
 private:
-	void transform(Nz::Vector2f * data, unsigned int size);
+	//vertices of one variant (type, rotation and flips) in the [0;1] space of the tile, computed once for all the variants
+	struct Prototype
+	{
+		Nz::Vector2f points[4];
+		unsigned int count;
+	};
+
+	static const Prototype & prototype(unsigned int variant);
+	unsigned int variant() const; //the low bits of toInt, without the collision layer
+	Prototype buildPrototype() const;
+
+	void transform(Nz::Vector2f * data, unsigned int size) const;
 	static void moveAndScale(Nz::Vector2f * data, unsigned int size, const Nz::Vector2f & pos, const Nz::Vector2f & scale);
 };
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Utility/Matrix.h"
+#include "Utility/MemoryPool.h"
 #include "Utility/Event/Event.h"
 #include "Tile.h"
 
@@ -14,12 +15,15 @@ class Tilemap;
 using TilemapRef = Nz::ObjectRef<Tilemap>;
 using TilemapConstRef = Nz::ObjectRef<const Tilemap>;
 
-class Tilemap : public Nz::RefCounted
+//the tilemaps of the chunks are created and destroyed while the world streams, the objects and their tiles come from the pools
+class Tilemap : public Nz::RefCounted, public PoolAllocated<Tilemap>
 {
+	using TileMatrix = Matrix<Tile, PoolAllocator<Tile>>;
+
 public:
 	using TileType = Tile;
-	using iterator = std::vector<TileType>::iterator;
-	using const_iterator = std::vector<TileType>::const_iterator;
+	using iterator = TileMatrix::iterator;
+	using const_iterator = TileMatrix::const_iterator;
 
 	struct TilemapModified
 	{
@@ -33,6 +37,8 @@ public:
 
 	TileType getTile(size_t x, size_t y) const;
 	void setTile(size_t x, size_t y, TileType value);
+	//replace the whole map, only one full map event is sent
+	void setTiles(const Matrix<TileType> & tiles);
 
 	const_iterator begin() const { return m_matrix.begin(); }
 	const_iterator end() const { return m_matrix.end(); }
@@ -41,6 +47,8 @@ public:
 	{
 		return m_event.connect(callback);
 	}
+	//the events are sent by EventQueue::dispatch, the events of the same tile are merged
+	void setQueuedEvents(bool queued);
 
 	template<typename... Args> static TilemapRef New(Args&&... args)
 	{
@@ -60,7 +68,7 @@ public:
 	void setTileDelta(unsigned int delta);
 
 private:
-	Matrix<TileType> m_matrix;
+	TileMatrix m_matrix;
 	Event<TilemapModified> m_event;
 	unsigned int m_tileSize = 1;
 	unsigned int m_tileDelta = 0;
@@ -26,16 +26,20 @@ class TilemapAnimations : public Nz::RefCounted
 public:
 	struct TilemapAnimationsModified {};
 
+	static constexpr size_t noAnimation = static_cast<size_t>(-1);
+
 	TilemapAnimations(float frameTime = 1.f);
 
 	void registerAnimation(unsigned int tileID, const TileAnimation & animation, const TileAnimationExpression & expression);
 	void registerAnimation(unsigned int tileID, const TileAnimation & animation, const std::string & expression);
 	void removeAnimation(unsigned int tileID);
 	bool haveAnimation(unsigned int tileID) const;
+	size_t lookup(unsigned int tileID) const; //index of the animation of the tile, noAnimation if it has none
 	TileAnimation animation(unsigned int tileID) const;
-	TileAnimationExpression animationExpression(unsigned int tileID) const;
+	const TileAnimationExpression & animationExpression(unsigned int tileID) const;
 	size_t index(unsigned int tileID) const;
 	const TileAnimation & animation(size_t index) const;
+	const TileAnimationExpression & animationExpression(size_t index) const;
 
 	void setFrameTime(float time);
 	float frameTime() const;
@@ -57,5 +61,6 @@ private:
 	Event<TilemapAnimationsModified> m_event;
 
 	std::vector<TileAnimationInfo> m_tileAnimations;
+	std::vector<size_t> m_indexs; //m_indexs[tileID], noAnimation for the tiles without animation
 	float m_frameTime;
 };
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//index of the lowest set bit, value must not be 0
+inline unsigned int lowestBit(uint32_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(__builtin_ctz(value));
+#endif
+}
+
+//number of consecutive set bits from the bit index
+inline unsigned int bitRunLength(uint32_t value, unsigned int index)
+{
+	uint32_t shifted = ~(value >> index);
+	if (shifted == 0)
+		return 32 - index;
+	return lowestBit(shifted);
+}
+
+//count bits set from the bit index
+inline uint32_t bitRange(unsigned int index, unsigned int count)
+{
+	if (count >= 32)
+		return ~uint32_t(0) << index;
+	return ((uint32_t(1) << count) - 1) << index;
+}
\ No newline at end of file
@@ -1,36 +1,80 @@
 #pragma once
 
+#include "EventQueue.h"
+#include "Utility/MemoryPool.h"
+
 #include <functional>
 #include <vector>
-#include <memory>
 
 template <typename T>
 class EventHolder;
 
-namespace
-{
-	template <typename T>
-	struct EventImpl
-	{
-		EventImpl(const std::function<void(const T &)> & _function);
-
-		std::function<void(const T &)> function;
-		bool blocked;
-	};
-}
-
+/* les listeners sont ranges dans un slot map : les fonctions sont contigues dans l'ordre de connexion,
+ * un EventHolder ne garde que l'index de son slot et la generation de ce slot
+ * deconnecter ne fait que marquer le listener mort, il n'est retire qu'au compactage, hors d'un send
+ * pas de compteur atomique : un event et ses holders sont utilises depuis un seul thread
+ * en mode queued, send ne fait que copier la valeur, les listeners sont appeles par EventQueue::dispatch
+ * les tableaux des listeners et des slots viennent des pools partages, connecter et deconnecter en boucle n'alloue plus
+ * */
 template <typename T>
 class Event
 {
 	friend class EventHolder<T>;
 public:
 	Event() = default;
+	Event(const Event<T> & e); //a copy starts without listener, the holders stay connected to the original
+	Event(Event<T> && e) noexcept;
+	Event<T> & operator=(const Event<T> &) = delete;
+	Event<T> & operator=(Event<T> && e) = delete;
+	~Event();
 
 	EventHolder<T> connect(const std::function<void(const T &)> & function);
 	void send(const T & value);
 
+	void setQueued(bool queued); //the values already queued are still sent by the next dispatch
+	bool isQueued() const;
+	//only the last of the queued values with the same key is sent, at its place
+	void setQueueKey(const std::function<size_t(const T &)> & key);
+
 private:
-	std::vector<std::weak_ptr<EventImpl<T>>> m_events;
+	struct Listener
+	{
+		std::function<void(const T &)> function;
+		unsigned int slot;
+		bool blocked;
+		bool dead;
+	};
+
+	struct Slot
+	{
+		size_t listener; //index in m_listeners, or past its end while it waits in m_pendingListeners
+		unsigned int generation;
+		EventHolder<T> * holder; //nullptr when the slot is free
+	};
+
+	Listener & listener(unsigned int slot);
+	bool isValid(unsigned int slot, unsigned int generation) const;
+	void disconnect(unsigned int slot);
+	void mergePendingListeners();
+	void compact();
+	void dispatch(const T & value);
+	static void dispatchQueue(void * e);
+	void mergeQueue();
+
+	std::vector<Listener, PoolAllocator<Listener>> m_listeners;
+	std::vector<Listener, PoolAllocator<Listener>> m_pendingListeners; //connected while sending, m_listeners must not move during the dispatch
+	std::vector<Slot, PoolAllocator<Slot>> m_slots;
+	std::vector<unsigned int, PoolAllocator<unsigned int>> m_freeSlots;
+	size_t m_deadListeners = 0;
+	unsigned int m_sendDepth = 0;
+
+	//queued mode, the two queues are swapped on dispatch to keep their memory
+	std::vector<T> m_queue;
+	std::vector<T> m_dispatchedQueue;
+	std::function<size_t(const T &)> m_queueKey;
+	std::vector<std::pair<size_t, size_t>> m_queueKeys; //key, index in m_dispatchedQueue
+	bool m_queued = false;
+	bool m_inEventQueue = false;
 };
 
 template <typename T>
@@ -65,8 +109,12 @@ public:
 	~EventHolder();
 
 private:
-	EventHolder(std::shared_ptr<EventImpl<T>> e);
-	std::shared_ptr<EventImpl<T>> m_eventImpl;
+	EventHolder(Event<T> * e, unsigned int slot, unsigned int generation);
+	void attach();
+
+	Event<T> * m_event = nullptr; //reset by the event if it is destroyed first
+	unsigned int m_slot = 0;
+	unsigned int m_generation = 0;
 };
 
 #include "Event.inl"
\ No newline at end of file
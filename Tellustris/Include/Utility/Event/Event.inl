@@ -3,37 +3,233 @@
 #include "Event.h"
 
 #include <algorithm>
-#include <iostream>
-#include <typeindex>
-		
+#include <cassert>
 
 template<typename T>
-EventImpl<T>::EventImpl(const std::function<void(const T &)> & _function)
-	: function(_function)
-	, blocked(false)
+Event<T>::Event(const Event<T> & e)
+	: m_queueKey(e.m_queueKey)
+	, m_queued(e.m_queued)
 {
 }
 
+template<typename T>
+Event<T>::Event(Event<T> && e) noexcept
+	: m_listeners(std::move(e.m_listeners))
+	, m_pendingListeners(std::move(e.m_pendingListeners))
+	, m_slots(std::move(e.m_slots))
+	, m_freeSlots(std::move(e.m_freeSlots))
+	, m_deadListeners(e.m_deadListeners)
+	, m_queueKey(std::move(e.m_queueKey))
+	, m_queued(e.m_queued)
+{
+	assert(e.m_sendDepth == 0);
+	assert(!e.m_inEventQueue);
+
+	e.m_deadListeners = 0;
+	for (auto & s : m_slots)
+		if (s.holder)
+			s.holder->m_event = this;
+}
+
+template<typename T>
+Event<T>::~Event()
+{
+	assert(m_sendDepth == 0);
+
+	if (m_inEventQueue)
+		EventQueue::remove(this);
+
+	for (auto & s : m_slots)
+		if (s.holder)
+			s.holder->m_event = nullptr;
+}
+
 template<typename T>
 inline EventHolder<T> Event<T>::connect(const std::function<void(const T&)>& function)
 {
-	auto func = std::make_shared<EventImpl<T>>(function);
-	m_events.push_back(func);
-	return EventHolder<T>(func);
+	unsigned int slot;
+	if (!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast<unsigned int>(m_slots.size());
+		m_slots.push_back({ 0, 0, nullptr });
+	}
+
+	m_slots[slot].listener = m_listeners.size() + m_pendingListeners.size();
+	if (m_sendDepth > 0)
+		m_pendingListeners.push_back({ function, slot, false, false });
+	else m_listeners.push_back({ function, slot, false, false });
+
+	return EventHolder<T>(this, slot, m_slots[slot].generation);
 }
 
 template<typename T>
 inline void Event<T>::send(const T & value)
 {
-	for (auto & e : m_events)
+	if (!m_queued)
 	{
-		auto eLock = e.lock();
-		if (!eLock || eLock->blocked || !eLock->function)
+		dispatch(value);
+		return;
+	}
+
+	m_queue.push_back(value);
+	if (!m_inEventQueue)
+	{
+		EventQueue::push(this, &Event<T>::dispatchQueue);
+		m_inEventQueue = true;
+	}
+}
+
+template<typename T>
+void Event<T>::setQueued(bool queued)
+{
+	m_queued = queued;
+}
+
+template<typename T>
+bool Event<T>::isQueued() const
+{
+	return m_queued;
+}
+
+template<typename T>
+void Event<T>::setQueueKey(const std::function<size_t(const T &)> & key)
+{
+	m_queueKey = key;
+}
+
+template<typename T>
+void Event<T>::dispatch(const T & value)
+{
+	//the listeners connected by a callback are only called by the next send
+	const size_t count = m_listeners.size();
+
+	m_sendDepth++;
+	for (size_t i = 0; i < count; i++)
+	{
+		const auto & l = m_listeners[i];
+		if (l.dead || l.blocked || !l.function)
 			continue;
-		eLock->function(value);
+		l.function(value);
 	}
+	m_sendDepth--;
 
-	m_events.erase(std::remove_if(m_events.begin(), m_events.end(), [](const auto & v) {return v.expired(); }), m_events.end());
+	if (m_sendDepth > 0)
+		return;
+
+	mergePendingListeners();
+	if (m_deadListeners * 2 > m_listeners.size())
+		compact();
+}
+
+template<typename T>
+void Event<T>::dispatchQueue(void * e)
+{
+	auto & event = *static_cast<Event<T> *>(e);
+	assert(event.m_dispatchedQueue.empty());
+
+	//the values sent by the listeners are queued again, for the next loop of EventQueue::dispatch
+	event.m_inEventQueue = false;
+	std::swap(event.m_queue, event.m_dispatchedQueue);
+	event.mergeQueue();
+
+	for (const auto & v : event.m_dispatchedQueue)
+		event.dispatch(v);
+	event.m_dispatchedQueue.clear();
+}
+
+template<typename T>
+void Event<T>::mergeQueue()
+{
+	if (!m_queueKey || m_dispatchedQueue.size() < 2)
+		return;
+
+	m_queueKeys.clear();
+	for (size_t i = 0; i < m_dispatchedQueue.size(); i++)
+		m_queueKeys.push_back({ m_queueKey(m_dispatchedQueue[i]), i });
+	std::sort(m_queueKeys.begin(), m_queueKeys.end());
+
+	//keep the last index of each key, then put them back in the order they were sent
+	size_t next = 0;
+	for (size_t i = 0; i < m_queueKeys.size(); i++)
+		if (i + 1 == m_queueKeys.size() || m_queueKeys[i + 1].first != m_queueKeys[i].first)
+			m_queueKeys[next++] = m_queueKeys[i];
+	m_queueKeys.resize(next);
+	std::sort(m_queueKeys.begin(), m_queueKeys.end(), [](const auto & a, const auto & b) {return a.second < b.second; });
+
+	for (size_t i = 0; i < m_queueKeys.size(); i++)
+		if (i != m_queueKeys[i].second)
+			m_dispatchedQueue[i] = std::move(m_dispatchedQueue[m_queueKeys[i].second]);
+	m_dispatchedQueue.erase(m_dispatchedQueue.begin() + m_queueKeys.size(), m_dispatchedQueue.end());
+}
+
+template<typename T>
+typename Event<T>::Listener & Event<T>::listener(unsigned int slot)
+{
+	size_t index = m_slots[slot].listener;
+	if (index < m_listeners.size())
+		return m_listeners[index];
+	return m_pendingListeners[index - m_listeners.size()];
+}
+
+template<typename T>
+bool Event<T>::isValid(unsigned int slot, unsigned int generation) const
+{
+	return slot < m_slots.size() && m_slots[slot].generation == generation && m_slots[slot].holder;
+}
+
+template<typename T>
+void Event<T>::disconnect(unsigned int slot)
+{
+	auto & l = listener(slot);
+	l.dead = true;
+	//the function can be the one running, it is only destroyed out of send
+	if (m_sendDepth == 0)
+		l.function = nullptr;
+	m_deadListeners++;
+
+	auto & s = m_slots[slot];
+	s.generation++;
+	s.holder = nullptr;
+	m_freeSlots.push_back(slot);
+
+	if (m_sendDepth == 0 && m_deadListeners * 2 > m_listeners.size())
+		compact();
+}
+
+template<typename T>
+void Event<T>::mergePendingListeners()
+{
+	//the slots of the pending listeners already point past the end of m_listeners, at their final index
+	if (m_pendingListeners.empty())
+		return;
+
+	for (auto & l : m_pendingListeners)
+		m_listeners.push_back(std::move(l));
+	m_pendingListeners.clear();
+}
+
+template<typename T>
+void Event<T>::compact()
+{
+	assert(m_sendDepth == 0 && m_pendingListeners.empty());
+
+	size_t next = 0;
+	for (size_t i = 0; i < m_listeners.size(); i++)
+	{
+		if (m_listeners[i].dead)
+			continue;
+		if (next != i)
+			m_listeners[next] = std::move(m_listeners[i]);
+		m_slots[m_listeners[next].slot].listener = next;
+		next++;
+	}
+	m_listeners.erase(m_listeners.begin() + next, m_listeners.end());
+	m_deadListeners = 0;
 }
 
 template <typename T>
@@ -57,17 +253,26 @@ inline Event<T> & StaticEvent<T>::instance()
 
 template<typename T>
 EventHolder<T>::EventHolder(EventHolder<T> && e) noexcept
-	: m_eventImpl(std::move(e.m_eventImpl))
+	: m_event(e.m_event)
+	, m_slot(e.m_slot)
+	, m_generation(e.m_generation)
 {
-	e.m_eventImpl = {};
+	e.m_event = nullptr;
+	attach();
 }
 
 template<typename T>
 EventHolder<T> & EventHolder<T>::operator=(EventHolder<T> && e) noexcept
 {
+	if (&e == this)
+		return *this;
+
 	disconnect();
-	m_eventImpl = e.m_eventImpl;
-	e.m_eventImpl = {};
+	m_event = e.m_event;
+	m_slot = e.m_slot;
+	m_generation = e.m_generation;
+	e.m_event = nullptr;
+	attach();
 	return *this;
 }
 
@@ -80,31 +285,33 @@ EventHolder<T>::operator bool() const
 template<typename T>
 bool EventHolder<T>::isDisconnected() const
 {
-	return !m_eventImpl;
+	return !m_event;
 }
 
 template<typename T>
 bool EventHolder<T>::isBlocked() const
 {
-	if (!m_eventImpl)
+	if (!m_event)
 		return false;
-	return m_eventImpl->blocked;
+	return m_event->listener(m_slot).blocked;
 }
 
 template<typename T>
 void EventHolder<T>::blockEvent(bool block)
 {
-	if (!m_eventImpl)
+	if (!m_event)
 		return;
-	m_eventImpl->blocked = block;
+	m_event->listener(m_slot).blocked = block;
 }
 
 template<typename T>
 void EventHolder<T>::disconnect()
 {
-	if (!m_eventImpl)
+	if (!m_event)
 		return;
-	m_eventImpl.reset();
+	assert(m_event->isValid(m_slot, m_generation));
+	m_event->disconnect(m_slot);
+	m_event = nullptr;
 }
 
 template<typename T>
@@ -114,7 +321,20 @@ EventHolder<T>::~EventHolder()
 }
 
 template<typename T>
-EventHolder<T>::EventHolder(std::shared_ptr<EventImpl<T>> e)
-	: m_eventImpl(e)
+EventHolder<T>::EventHolder(Event<T> * e, unsigned int slot, unsigned int generation)
+	: m_event(e)
+	, m_slot(slot)
+	, m_generation(generation)
 {
+	attach();
 }
+
+template<typename T>
+void EventHolder<T>::attach()
+{
+	//the event keeps the address of the holder to reset it if it is destroyed first
+	if (!m_event)
+		return;
+	assert(m_slot < m_event->m_slots.size() && m_event->m_slots[m_slot].generation == m_generation);
+	m_event->m_slots[m_slot].holder = this;
+}
\ No newline at end of file
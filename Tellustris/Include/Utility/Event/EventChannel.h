@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <atomic>
+
+/* canal entre les threads de travail et le thread principal
+ * post peut etre appele depuis n'importe quel thread, sans mutex : la valeur est ajoutee a une pile par compare_exchange
+ * les valeurs sont lues sur le thread principal par EventQueue::dispatch, dans l'ordre ou elles ont ete postees,
+ * et passees au receiver (par exemple un Events::send ou un BehaviourComponent::send)
+ * le canal est cree et detruit sur le thread principal, et doit survivre aux taches qui y postent
+ * */
+template <typename T>
+class EventChannel
+{
+public:
+	EventChannel(const std::function<void(const T &)> & receiver);
+	EventChannel(const EventChannel<T> &) = delete;
+	EventChannel<T> & operator=(const EventChannel<T> &) = delete;
+	~EventChannel();
+
+	void post(const T & value);
+	void post(T && value);
+
+	void receive(); //main thread only, called by EventQueue::dispatch
+
+private:
+	struct Node
+	{
+		T value;
+		Node * next;
+	};
+
+	void push(Node * node);
+	static void receiveChannel(void * channel);
+
+	std::function<void(const T &)> m_receiver;
+	std::atomic<Node *> m_head;
+};
+
+#include "EventChannel.inl"
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "EventChannel.h"
+#include "EventQueue.h"
+
+template<typename T>
+EventChannel<T>::EventChannel(const std::function<void(const T &)> & receiver)
+	: m_receiver(receiver)
+	, m_head(nullptr)
+{
+	EventQueue::addChannel(this, &EventChannel<T>::receiveChannel);
+}
+
+template<typename T>
+EventChannel<T>::~EventChannel()
+{
+	EventQueue::removeChannel(this);
+
+	auto node = m_head.exchange(nullptr, std::memory_order_acquire);
+	while (node)
+	{
+		auto next = node->next;
+		delete node;
+		node = next;
+	}
+}
+
+template<typename T>
+void EventChannel<T>::post(const T & value)
+{
+	push(new Node{ value, nullptr });
+}
+
+template<typename T>
+void EventChannel<T>::post(T && value)
+{
+	push(new Node{ std::move(value), nullptr });
+}
+
+template<typename T>
+void EventChannel<T>::receive()
+{
+	auto node = m_head.exchange(nullptr, std::memory_order_acquire);
+
+	//the stack gives the last posted value first
+	Node * first = nullptr;
+	while (node)
+	{
+		auto next = node->next;
+		node->next = first;
+		first = node;
+		node = next;
+	}
+
+	while (first)
+	{
+		auto next = first->next;
+		if (m_receiver)
+			m_receiver(first->value);
+		delete first;
+		first = next;
+	}
+}
+
+template<typename T>
+void EventChannel<T>::push(Node * node)
+{
+	node->next = m_head.load(std::memory_order_relaxed);
+	while (!m_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<typename T>
+void EventChannel<T>::receiveChannel(void * channel)
+{
+	static_cast<EventChannel<T> *>(channel)->receive();
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+/* liste des events en mode queued qui ont des valeurs en attente
+ * un event s'y inscrit a son premier send depuis le dernier dispatch, et s'en retire a sa destruction
+ * dispatch est appele une fois par frame, par BehaviourSystem
+ * les EventChannel y restent inscrits toute leur vie, leurs valeurs sont lues au debut de chaque dispatch
+ * */
+class EventQueue
+{
+public:
+	using DispatchFunction = void(*)(void *);
+
+	static void push(void * event, DispatchFunction function);
+	static void remove(void * event);
+
+	static void addChannel(void * channel, DispatchFunction function);
+	static void removeChannel(void * channel);
+
+	//send the queued values of all the events, the values queued by the listeners are sent in the same call
+	static void dispatch();
+
+private:
+	struct QueuedEvent
+	{
+		void * event;
+		DispatchFunction function;
+	};
+
+	EventQueue() = delete;
+
+	static std::vector<QueuedEvent> m_events;
+	static std::vector<QueuedEvent> m_dispatchedEvents;
+	static std::vector<QueuedEvent> m_channels;
+	static bool m_dispatching;
+};
\ No newline at end of file
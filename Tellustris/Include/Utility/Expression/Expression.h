@@ -3,61 +3,95 @@
 #include "ExpressionValue.h"
 
 #include <vector>
+#include <string>
 #include <memory>
+#include <algorithm>
 #include <cassert>
 
 namespace NExpression
 {
-	namespace
-	{
-		template <typename T>
-		struct ParameterIndex
-		{
-			Parameter<T> *parameter = nullptr;
-			size_t index = 0;
-		};
-	}
-
 	template <typename T>
 	class ExpressionParser;
 
+	/* le programme compile (et l'arbre, pour toString) est immuable et partage par toutes les copies
+	 * chaque copie n'a que ses registres, crees a la premiere evaluation
+	 * copier une expression jamais evaluee n'alloue donc rien
+	 * */
 	template <typename T>
 	class Expression
 	{
 	public:
 		friend class ExpressionParser<T>;
-		friend class Parameter<T>;
 
 		Expression() = default;
 		~Expression() = default;
 
 		Expression(const Expression<T> & expression)
-			: m_value(expression.m_value ? expression.m_value->clone() : nullptr)
+			: m_data(expression.m_data)
+			, m_registers(expression.m_registers)
 		{
-			m_value->registerParameter(*this);
+
 		}
 
 		Expression & operator=(const Expression<T> & expression)
 		{
-			m_value.reset();
-			if(expression.m_value)
-				m_value = expression.m_value->clone();
-
-			m_parameterNames.clear();
-			m_parameters.clear();
-
-			if(m_value)
-				m_value->registerParameter(*this);
-
+			m_data = expression.m_data;
+			m_registers = expression.m_registers;
 			return *this;
 		}
 
+		Expression(Expression<T> &&) = default;
+		Expression & operator=(Expression<T> &&) = default;
 
 		T compute() const
 		{
-			if (!m_value)
+			if (!m_data)
+				return T(0);
+			initRegisters();
+			return m_data->program.run(m_registers.data(), m_arguments);
+		}
+
+		//the parameter i reads values[slots[i]], the slots are found once by the caller from parameterNames
+		T compute(const T * values, const size_t * slots) const
+		{
+			if (!m_data)
+				return T(0);
+			initRegisters();
+			return run(values, slots, m_registers, m_arguments);
+		}
+
+		/* same, with the evaluation buffers given by the caller instead of the ones of this expression
+		 * they are resized for the program, the same vectors can be used for all the expressions,
+		 * and the expression can be evaluated from several threads at once (rand has an engine per thread),
+		 * unless it calls a function added with ExpressionParser::addFunction that isn't thread safe
+		 * */
+		T compute(const T * values, const size_t * slots, std::vector<T> & registers, std::vector<T> & arguments) const
+		{
+			if (!m_data)
 				return T(0);
-			return m_value->get();
+			m_data->program.initRegisters(registers);
+			return run(values, slots, registers, arguments);
+		}
+
+		//false if the expression calls rand or a user function, the result can then change with the same parameters
+		bool isPure() const
+		{
+			return !m_data || m_data->program.isPure();
+		}
+
+		/* compute the expression for count sets of parameters at once, in out
+		 * parameters[i] points to the count values of the parameter i (see parameterNames),
+		 * a null pointer keeps the value given to setParameter
+		 * */
+		void computeBatch(const T * const * parameters, size_t count, T * out) const
+		{
+			if (!m_data)
+			{
+				std::fill(out, out + count, T(0));
+				return;
+			}
+			initRegisters();
+			m_data->program.runBatch(parameters, count, out, m_registers.data(), m_batchRegisters, m_arguments);
 		}
 
 		void setParameter(const std::string & name, T value)
@@ -65,53 +99,86 @@ namespace NExpression
 			setParameter(nameIndex(name), value);
 		}
 
+		//the parameters are the first registers of the program
 		void setParameter(size_t index, T value)
 		{
-			for (auto & p : m_parameters)
-			{
-				if (p.index == index)
-					p.parameter->set(value);
-			}
+			if (!m_data || index >= m_data->program.parameterCount())
+				return;
+			initRegisters();
+			m_registers[index] = value;
 		}
 
 		void resetParameters()
 		{
-			for (auto & p : m_parameters)
-			{
-				T zero = {};
-				for (auto & p : m_parameters)
-					p.parameter->set(zero);
-			}
+			if (!m_data || m_registers.empty())
+				return;
+			std::fill(m_registers.begin(), m_registers.begin() + m_data->program.parameterCount(), T(0));
 		}
-		
-		size_t nameIndex(const std::string & name)
+
+		size_t nameIndex(const std::string & name) const
 		{
-			for (size_t i = 0; i < m_parameterNames.size(); i++)
-				if (m_parameterNames[i] == name)
+			const auto & names = parameterNames();
+			for (size_t i = 0; i < names.size(); i++)
+				if (names[i] == name)
 					return i;
 
-			return m_parameterNames.size();
+			return names.size();
+		}
+
+		const std::vector<std::string> & parameterNames() const
+		{
+			static const std::vector<std::string> noNames;
+			if (!m_data)
+				return noNames;
+			return m_data->parameterNames;
 		}
 
 		std::string toString() const
 		{
-			if (!m_value)
+			if (!m_data)
 				return "";
-			return m_value->toString();
+			return m_data->value->toString();
 		}
 
 	private:
-		void addParameter(Parameter<T> * parameter)
+		struct Data
+		{
+			ValueRef<T> value;
+			std::vector<std::string> parameterNames;
+			ExpressionProgram<T> program;
+		};
+
+		//called by the parser once the tree is done
+		Expression(ValueRef<T> value, std::vector<std::string> parameterNames)
+		{
+			auto data = std::make_shared<Data>();
+			data->value = std::move(value);
+			data->parameterNames = std::move(parameterNames);
+
+			ProgramBuilder<T> builder(data->parameterNames);
+			auto result = data->value->compile(builder);
+			data->program = builder.build(result);
+
+			m_data = std::move(data);
+		}
+
+		void initRegisters() const
+		{
+			if (m_registers.empty())
+				m_data->program.initRegisters(m_registers);
+		}
+
+		T run(const T * values, const size_t * slots, std::vector<T> & registers, std::vector<T> & arguments) const
 		{
-			auto index = nameIndex(parameter->name());
-			if (index == m_parameterNames.size())
-				m_parameterNames.push_back(parameter->name());
-			m_parameters.push_back(ParameterIndex<T>{ parameter, index });
+			for (size_t i = 0; i < m_data->program.parameterCount(); i++)
+				registers[i] = values[slots[i]];
+			return m_data->program.run(registers.data(), arguments);
 		}
 
-		ValueRef<T> m_value;
+		std::shared_ptr<const Data> m_data;
 
-		std::vector<std::string> m_parameterNames;
-		std::vector<ParameterIndex<T>> m_parameters;
+		mutable std::vector<T> m_registers;
+		mutable std::vector<T> m_arguments;
+		mutable std::vector<T> m_batchRegisters;
 	};
 }
\ No newline at end of file
@@ -6,16 +6,45 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <string>
+#include <string_view>
+#include <stdexcept>
 #include <functional>
 
 namespace NExpression
 {
+	//error of ExpressionParser::evaluate, position is the index of the character where the parsing stopped
+	class ParseError : public std::invalid_argument
+	{
+	public:
+		ParseError(const std::string & message, size_t position)
+			: std::invalid_argument(message + " at position " + std::to_string(position))
+			, m_message(message)
+			, m_position(position)
+		{
+
+		}
+
+		const std::string & message() const { return m_message; }
+		size_t position() const { return m_position; }
+
+	private:
+		std::string m_message;
+		size_t m_position;
+	};
+
+	/* lexer et parser en une passe, sans copie de la chaine
+	 * les operateurs gardent les priorites historiques, de la plus faible a la plus forte :
+	 * + - * / ^ && || >= <= != == = > < puis ! et le - unaire
+	 * +, -, * et / donnent des noeuds n-aires, les autres sont associatifs a droite
+	 * */
 	template <typename T>
 	class ExpressionParser
 	{
 	public:
 		ExpressionParser();
 
+		//by default the numbers are read with strtod / strtoll
 		void setParseFunction(const std::function<T(std::string)> & f)
 		{
 			m_parseFunction = f;
@@ -34,19 +63,59 @@ namespace NExpression
 		Expression<T> evaluate(const std::string & s);
 
 	private:
-		ValueRef<T> parse(std::string s);
-		ValueRef<T> parseOperators(std::string & s);
+		enum class TokenType
+		{
+			End,
+			Number,
+			Identifier,
+			Plus,
+			Minus,
+			Star,
+			Slash,
+			Caret,
+			And,
+			Or,
+			GreaterEqual,
+			LessEqual,
+			NotEqual,
+			EqualEqual,
+			Equal,
+			Greater,
+			Less,
+			Not,
+			OpenBracket,
+			CloseBracket,
+			Comma,
+		};
+
+		struct Token
+		{
+			TokenType type;
+			size_t begin;
+			size_t end;
+		};
+
+		static bool isIdentifierChar(char c);
+
+		void nextToken();
+		std::string_view tokenText() const;
+		[[noreturn]] void error(const std::string & message) const;
+
+		ValueRef<T> parseLevel(size_t level);
+		ValueRef<T> parseUnary();
+		ValueRef<T> parsePrimary();
+		ValueRef<T> parseNumber();
+		ValueRef<T> parseFunction(std::string_view name);
 
-		void substitudeBracket(std::string & s, size_t index);
-		size_t findClosingBracket(std::string & s, size_t start, char openC, char closeC);
-		bool validIdentifier(std::string s);
+		std::string_view m_source;
+		Token m_token;
 
-		std::vector<std::string> m_bracketHeap;
 		std::function<T(std::string)> m_parseFunction;
-		Expression<T> m_expression;
+		std::vector<std::string> m_parameterNames;
 
-		std::map<std::string, T> m_constants;
-		std::map<std::string, ExpressionFunction<T>> m_functions;
+		std::map<std::string, T, std::less<>> m_constants;
+		std::map<std::string, ExpressionFunction<T>, std::less<>> m_functions;
+		std::map<std::string, BuiltinFunction, std::less<>> m_builtins;
 	};
 }
 
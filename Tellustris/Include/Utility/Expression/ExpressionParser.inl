@@ -1,13 +1,14 @@
 
 #include "ExpressionParser.h"
-#include "Utility/StringOperation.h"
 #include "Utility/StaticRandomGenerator.h"
 
 #include <cassert>
-#include <exception>
-#include <stdexcept>
+#include <cctype>
+#include <cstdlib>
+#include <cerrno>
 #include <type_traits>
 #include <algorithm>
+#include <iterator>
 #include <random>
 
 namespace NExpression
@@ -15,25 +16,6 @@ namespace NExpression
 	template <typename T>
 	ExpressionParser<T>::ExpressionParser()
 	{
-		if constexpr (std::is_same_v<int, T>)
-			setParseFunction([](const auto & s) {return std::stoi(s); });
-		if constexpr (std::is_same_v<long, T>)
-			setParseFunction([](const auto & s) {return std::stol(s); });
-		if constexpr (std::is_same_v<long long, T>)
-			setParseFunction([](const auto & s) {return std::stoll(s); });
-
-		if constexpr (std::is_same_v<unsigned long, T> || std::is_same_v<unsigned int, T>)
-			setParseFunction([](const auto & s) {return std::stoul(s); });
-		if constexpr (std::is_same_v<unsigned long long, T>)
-			setParseFunction([](const auto & s) {return std::stoul(s); });
-
-		if constexpr (std::is_same_v<float, T>)
-			setParseFunction([](const auto & s) {return std::stof(s); });
-		if constexpr (std::is_same_v<double, T>)
-			setParseFunction([](const auto & s) {return std::stod(s); });
-		if constexpr (std::is_same_v<long double, T>)
-			setParseFunction([](const auto & s) {return std::stold(s); });
-
 		if constexpr (std::is_integral_v<T> && !std::is_same_v<bool, T>)
 		{
 			m_functions.emplace("sqrt", [](const std::vector<T> & values) -> T
@@ -54,6 +36,14 @@ namespace NExpression
 					return 0;
 				return static_cast<T>(std::log10(values[0]));
 			});
+			m_functions.emplace("abs", [](const std::vector<T> & values) -> T
+			{
+				if (values.empty())
+					return 0;
+				if constexpr (std::is_signed_v<T>)
+					return std::abs(values[0]);
+				else return values[0];
+			});
 			m_functions.emplace("min", [](const std::vector<T> & values) -> T
 			{
 				if (values.empty())
@@ -119,6 +109,12 @@ namespace NExpression
 					return 0;
 				return std::log10(values[0]);
 			});
+			m_functions.emplace("abs", [](const std::vector<T> & values) -> T
+			{
+				if (values.empty())
+					return 0;
+				return std::abs(values[0]);
+			});
 			m_functions.emplace("sin", [](const std::vector<T> & values) -> T
 			{
 				if (values.empty())
@@ -200,6 +196,18 @@ namespace NExpression
 				return d(rand);
 			});
 		}
+
+		//the program runs these ones without calling the std::function
+		const std::pair<const char *, BuiltinFunction> builtins[] =
+		{
+			{ "sqrt", BuiltinFunction::Sqrt }, { "ln", BuiltinFunction::Ln }, { "log", BuiltinFunction::Log }, { "abs", BuiltinFunction::Abs },
+			{ "sin", BuiltinFunction::Sin }, { "cos", BuiltinFunction::Cos }, { "tan", BuiltinFunction::Tan },
+			{ "asin", BuiltinFunction::Asin }, { "acos", BuiltinFunction::Acos }, { "atan", BuiltinFunction::Atan }, { "atan2", BuiltinFunction::Atan2 },
+			{ "min", BuiltinFunction::Min }, { "max", BuiltinFunction::Max }, { "clamp", BuiltinFunction::Clamp }, { "rand", BuiltinFunction::Rand },
+		};
+		for (const auto & b : builtins)
+			if (m_functions.find(b.first) != m_functions.end())
+				m_builtins.emplace(b.first, b.second);
 	}
 
 	template <typename T>
@@ -236,6 +244,7 @@ namespace NExpression
 	void ExpressionParser<T>::addFunction(const std::string & name, ExpressionFunction<T> func)
 	{
 		assert(func);
+		m_builtins.erase(name);
 		auto it = m_functions.find(name);
 		if (it == m_functions.end())
 			m_functions.emplace(name, func);
@@ -246,6 +255,7 @@ namespace NExpression
 	void ExpressionParser<T>::removeFunction(const std::string & name)
 	{
 		m_functions.erase(name);
+		m_builtins.erase(name);
 	}
 
 	template <typename T>
@@ -266,256 +276,337 @@ namespace NExpression
 	template <typename T>
 	Expression<T> ExpressionParser<T>::evaluate(const std::string & s)
 	{
-		m_expression = std::move(Expression<T>());
-
-		m_expression.m_value = parse(s);
+		m_parameterNames.clear();
+		m_source = s;
+		m_token = Token{ TokenType::End, 0, 0 };
+
+		nextToken();
+		auto value = parseLevel(0);
+		if (m_token.type == TokenType::CloseBracket)
+			error("Bracket not opened");
+		if (m_token.type != TokenType::End)
+			error("Unexpected token");
+
+		return Expression<T>(std::move(value), std::move(m_parameterNames));
+	}
 
-		return std::move(m_expression);
+	template <typename T>
+	bool ExpressionParser<T>::isIdentifierChar(char c)
+	{
+		return !std::isspace(static_cast<unsigned char>(c)) && std::string_view("+-*/^&|<>=!(),").find(c) == std::string_view::npos;
 	}
 
 	template <typename T>
-	ValueRef<T> ExpressionParser<T>::parse(std::string s)
+	void ExpressionParser<T>::nextToken()
 	{
-		trim(s);
-		auto index = s.find('(');
-		while (index != std::string::npos)
+		auto pos = m_token.end;
+		while (pos < m_source.size() && std::isspace(static_cast<unsigned char>(m_source[pos])))
+			pos++;
+
+		m_token = Token{ TokenType::End, pos, pos };
+		if (pos >= m_source.size())
+			return;
+
+		auto at = [this](size_t i) { return i < m_source.size() ? m_source[i] : '\0'; };
+		auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+		auto single = [this, pos](TokenType type) { m_token = Token{ type, pos, pos + 1 }; };
+		auto pair = [this, pos, &at](char second, TokenType doubleType, TokenType singleType)
 		{
-			substitudeBracket(s, index);
-			index = s.find('(');
-		}
+			if (at(pos + 1) == second)
+				m_token = Token{ doubleType, pos, pos + 2 };
+			else m_token = Token{ singleType, pos, pos + 1 };
+		};
 
-		auto value = parseOperators(s);
-		if (value)
-			return value;
-
-		for (const auto & c : m_constants)
+		char c = m_source[pos];
+		switch (c)
 		{
-			if (c.first == s)
-				return std::make_unique<Constant<T>>(s, c.second);
+		case '+': single(TokenType::Plus); return;
+		case '-': single(TokenType::Minus); return;
+		case '*': single(TokenType::Star); return;
+		case '/': single(TokenType::Slash); return;
+		case '^': single(TokenType::Caret); return;
+		case '(': single(TokenType::OpenBracket); return;
+		case ')': single(TokenType::CloseBracket); return;
+		case ',': single(TokenType::Comma); return;
+		case '>': pair('=', TokenType::GreaterEqual, TokenType::Greater); return;
+		case '<': pair('=', TokenType::LessEqual, TokenType::Less); return;
+		case '=': pair('=', TokenType::EqualEqual, TokenType::Equal); return;
+		case '!': pair('=', TokenType::NotEqual, TokenType::Not); return;
+		case '&':
+			if (at(pos + 1) != '&')
+				error("Expected &&");
+			m_token = Token{ TokenType::And, pos, pos + 2 };
+			return;
+		case '|':
+			if (at(pos + 1) != '|')
+				error("Expected ||");
+			m_token = Token{ TokenType::Or, pos, pos + 2 };
+			return;
+		default:
+			break;
 		}
 
-		auto pos = s.find("&");
-		if(pos > 0 && pos != std::string::npos)
+		auto end = pos;
+		if (isDigit(c) || (c == '.' && isDigit(at(pos + 1))))
 		{
-			auto fName = s.substr(0, pos);
-			for (const auto & f : m_functions)
+			while (isDigit(at(end)))
+				end++;
+			if (at(end) == '.')
+			{
+				end++;
+				while (isDigit(at(end)))
+					end++;
+			}
+			//the exponent only if it is complete, "2e" is left to the error below
+			if (at(end) == 'e' || at(end) == 'E')
 			{
-				if (f.first == fName)
+				auto exponent = end + 1;
+				if (at(exponent) == '+' || at(exponent) == '-')
+					exponent++;
+				if (isDigit(at(exponent)))
 				{
-					auto inner = s.substr(pos + 1, s.size() - pos - 2); //...&...;
-					size_t bracketIndex = std::stoull(inner);
-					if (bracketIndex < m_bracketHeap.size())
-						inner = m_bracketHeap[bracketIndex];
-					else throw std::invalid_argument("Can't parse substitude token");
-					auto parts = split(inner, ',');
-					std::vector<ValueRef<T>> values;
-					values.reserve(parts.size());
-					for (const auto & p : parts)
-					{
-						auto trimed = trim_copy(p);
-						if (!trimed.empty())
-							values.emplace_back(parse(trimed));
-					}
-					return std::make_unique<Function<T>>(f.first, f.second, values.begin(), values.end());
+					end = exponent;
+					while (isDigit(at(end)))
+						end++;
 				}
 			}
+			m_token = Token{ TokenType::Number, pos, end };
+			if (end < m_source.size() && isIdentifierChar(m_source[end]))
+				error("Invalid number");
+			return;
 		}
 
-		auto posBegin = s.find('&');
-		auto posEnd = s.find(';');
-		if (posBegin != std::string::npos && posEnd != std::string::npos && posEnd >= 2)
-		{
-			auto inner = s.substr(posBegin + 1, posEnd - posBegin - 1);
-			size_t bracketIndex = std::stoull(inner);
-			if (bracketIndex < m_bracketHeap.size())
-				return parse(m_bracketHeap[bracketIndex]);
-			throw std::invalid_argument("Can't parse substitude token");
-		}
-		if (!m_parseFunction)
-			throw std::invalid_argument("No parse function found!");
-		try
-		{
-			return std::make_unique<Number<T>>(m_parseFunction(s));
-		}
-		catch (std::exception e) {}
+		if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_')
+			error("Unexpected character");
 
-		if (validIdentifier(s))
-		{
-			auto param = std::make_unique<Parameter<T>>(s);
-			m_expression.addParameter(param.get());
-			return param;
-		}
+		while (end < m_source.size() && isIdentifierChar(m_source[end]))
+			end++;
+		m_token = Token{ TokenType::Identifier, pos, end };
+	}
 
-		throw std::invalid_argument("Reached unexpected end within the parsing tree");
+	template <typename T>
+	std::string_view ExpressionParser<T>::tokenText() const
+	{
+		return m_source.substr(m_token.begin, m_token.end - m_token.begin);
+	}
+
+	template <typename T>
+	void ExpressionParser<T>::error(const std::string & message) const
+	{
+		throw ParseError(message, m_token.begin);
 	}
 
 	template <typename T>
-	ValueRef<T> ExpressionParser<T>::parseOperators(std::string & s)
+	ValueRef<T> ExpressionParser<T>::parseLevel(size_t level)
 	{
-		if (s.find('+') != std::string::npos)
+		//from the weakest to the strongest, like the splits of the old string parser
+		static const TokenType levels[] =
 		{
-			auto parts = split(s, '+');
-			std::vector<ValueRef<T>> exp;
-			exp.reserve(parts.size());
-			for (const auto & p : parts)
+			TokenType::Plus, TokenType::Minus, TokenType::Star, TokenType::Slash, TokenType::Caret,
+			TokenType::And, TokenType::Or, TokenType::GreaterEqual, TokenType::LessEqual, TokenType::NotEqual,
+			TokenType::EqualEqual, TokenType::Equal, TokenType::Greater, TokenType::Less,
+		};
+
+		if (level >= std::size(levels))
+			return parseUnary();
+
+		auto op = levels[level];
+		std::vector<ValueRef<T>> values;
+
+		switch (op)
+		{
+		case TokenType::Plus:
+			if (m_token.type == TokenType::Plus)
+				nextToken();
+			values.push_back(parseLevel(level + 1));
+			while (m_token.type == TokenType::Plus)
 			{
-				auto trimed = trim_copy(p);
-				if (!trimed.empty())
-					exp.emplace_back(parse(trimed));
+				nextToken();
+				values.push_back(parseLevel(level + 1));
 			}
-			if (exp.empty())
-				throw std::invalid_argument("Nothing to add!");
-			if (exp.size() == 1)
-				return std::move(exp[0]);
-			return std::make_unique<OperationSum<T>>(exp.begin(), exp.end());
-		}
-		else if (s.find('-') != std::string::npos)
-		{
-			auto parts = split(s, '-');
-			std::vector<ValueRef<T>> exp;
-			exp.reserve(parts.size());
-			if (!parts[0].empty())
-				exp.emplace_back(parse(parts[0]));
-			for (size_t i = 1; i < parts.size(); i++)
+			if (values.size() == 1)
+				return std::move(values[0]);
+			return std::make_unique<OperationSum<T>>(values.begin(), values.end());
+		case TokenType::Minus:
+			if (m_token.type != TokenType::Minus)
+				values.push_back(parseLevel(level + 1));
+			while (m_token.type == TokenType::Minus)
 			{
-				auto trimed = trim_copy(parts[i]);
-				if (!trimed.empty())
-					exp.emplace_back(std::make_unique<OperationNegate<T>>(parse(trimed)));
+				nextToken();
+				values.push_back(std::make_unique<OperationNegate<T>>(parseLevel(level + 1)));
 			}
-			if (exp.empty())
-				throw std::invalid_argument("Nothing to sub!");
-			if (exp.size() == 1)
-				return std::move(exp[0]);
-			return std::make_unique<OperationSum<T>>(exp.begin(), exp.end());
-		}
-		else if (s.find('*') != std::string::npos)
-		{
-			auto parts = split(s, '*');
-			std::vector<ValueRef<T>> exp;
-			exp.reserve(parts.size());
-			for (const auto & p : parts)
-				exp.emplace_back(parse(p));
-			if (exp.size() == 1)
-				return std::move(exp[0]);
-			return std::make_unique<OperationProduct<T>>(exp.begin(), exp.end());
-		}
-		else if (s.find('/') != std::string::npos)
-		{
-			auto parts = split(s, '/');
-			std::vector<ValueRef<T>> exp;
-			exp.reserve(parts.size());
-			for (const auto & p : parts)
-				exp.emplace_back(parse(p));
-			if (exp.size() == 1)
-				return std::move(exp[0]);
-			return std::make_unique<OperationReciprocal<T>>(exp.begin(), exp.end());
-		}
-		else if (s.find('^') != std::string::npos)
-		{
-			auto pos = s.find('^');
-			return std::make_unique<OperationPower<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 1)));
-		}		
-		else if (s.find("&&") != std::string::npos)
-		{
-			auto pos = s.find("&&");
-			return std::make_unique<ConditionAnd<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 2)));
-		}
-		else if (s.find("||") != std::string::npos)
-		{
-			auto pos = s.find("||");
-			return std::make_unique<ConditionOr<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 2)));
-		}
-		else if (s.find(">=") != std::string::npos)
-		{
-			auto pos = s.find(">=");
-			return std::make_unique<ComparisonSupOrEqual<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 2)));
-		}
-		else if (s.find("<=") != std::string::npos)
-		{
-			auto pos = s.find("<=");
-			return std::make_unique<ComparisonSubOrEqual<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 2)));
+			if (values.size() == 1)
+				return std::move(values[0]);
+			return std::make_unique<OperationSum<T>>(values.begin(), values.end());
+		case TokenType::Star:
+		case TokenType::Slash:
+			values.push_back(parseLevel(level + 1));
+			while (m_token.type == op)
+			{
+				nextToken();
+				values.push_back(parseLevel(level + 1));
+			}
+			if (values.size() == 1)
+				return std::move(values[0]);
+			if (op == TokenType::Star)
+				return std::make_unique<OperationProduct<T>>(values.begin(), values.end());
+			return std::make_unique<OperationReciprocal<T>>(values.begin(), values.end());
+		default:
+			break;
 		}
-		else if (s.find("!=") != std::string::npos)
+
+		auto left = parseLevel(level + 1);
+		if (m_token.type != op)
+			return left;
+		nextToken();
+		auto right = parseLevel(level);
+
+		switch (op)
 		{
-			auto pos = s.find("!=");
-			return std::make_unique<ComparisonUnequal<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 2)));
+		case TokenType::Caret:
+			return std::make_unique<OperationPower<T>>(std::move(left), std::move(right));
+		case TokenType::And:
+			return std::make_unique<ConditionAnd<T>>(std::move(left), std::move(right));
+		case TokenType::Or:
+			return std::make_unique<ConditionOr<T>>(std::move(left), std::move(right));
+		case TokenType::GreaterEqual:
+			return std::make_unique<ComparisonSupOrEqual<T>>(std::move(left), std::move(right));
+		case TokenType::LessEqual:
+			return std::make_unique<ComparisonSubOrEqual<T>>(std::move(left), std::move(right));
+		case TokenType::NotEqual:
+			return std::make_unique<ComparisonUnequal<T>>(std::move(left), std::move(right));
+		case TokenType::Greater:
+			return std::make_unique<ComparisonSup<T>>(std::move(left), std::move(right));
+		case TokenType::Less:
+			return std::make_unique<ComparisonSub<T>>(std::move(left), std::move(right));
+		default:
+			return std::make_unique<ComparisonEqual<T>>(std::move(left), std::move(right));
 		}
-		else if (s.find("==") != std::string::npos)
+	}
+
+	template <typename T>
+	ValueRef<T> ExpressionParser<T>::parseUnary()
+	{
+		if (m_token.type == TokenType::Not)
 		{
-			auto pos = s.find("==");
-			return std::make_unique<ComparisonEqual<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 2)));
+			nextToken();
+			return std::make_unique<ConditionNot<T>>(parseUnary());
 		}
-		else if (s.find('=') != std::string::npos)
+		if (m_token.type == TokenType::Minus)
 		{
-			auto pos = s.find('=');
-			return std::make_unique<ComparisonEqual<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 1)));
+			nextToken();
+			return std::make_unique<OperationNegate<T>>(parseUnary());
 		}
-		else if (s.find('>') != std::string::npos)
+		return parsePrimary();
+	}
+
+	template <typename T>
+	ValueRef<T> ExpressionParser<T>::parsePrimary()
+	{
+		if (m_token.type == TokenType::Number)
+			return parseNumber();
+
+		if (m_token.type == TokenType::OpenBracket)
 		{
-			auto pos = s.find('>');
-			return std::make_unique<ComparisonSup<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 1)));
+			nextToken();
+			auto value = parseLevel(0);
+			if (m_token.type != TokenType::CloseBracket)
+				error("Bracket not closed");
+			nextToken();
+			return value;
 		}
-		else if (s.find('<') != std::string::npos)
+
+		if (m_token.type == TokenType::End)
+			error("Unexpected end of expression");
+		if (m_token.type != TokenType::Identifier)
+			error("Unexpected token");
+
+		auto name = tokenText();
+		auto start = m_token;
+		nextToken();
+
+		if (m_token.type == TokenType::OpenBracket)
 		{
-			auto pos = s.find('<');
-			return std::make_unique<ComparisonSub<T>>(parse(s.substr(0, pos)), parse(s.substr(pos + 1)));
+			if (m_functions.find(name) == m_functions.end())
+			{
+				m_token = start;
+				error("Unknown function");
+			}
+			return parseFunction(name);
 		}
-		else if (s.find('!') != std::string::npos)
+
+		auto constant = m_constants.find(name);
+		if (constant != m_constants.end())
+			return std::make_unique<Constant<T>>(constant->first, constant->second);
+
+		if (m_functions.find(name) != m_functions.end())
 		{
-			auto pos = s.find('!');
-			return std::make_unique<ConditionNot<T>>(parse(s.substr(pos + 1)));
+			m_token = start;
+			error("Function called without brackets");
 		}
 
-		return {};
+		auto param = std::make_unique<Parameter<T>>(std::string(name));
+		if (std::find(m_parameterNames.begin(), m_parameterNames.end(), param->name()) == m_parameterNames.end())
+			m_parameterNames.push_back(param->name());
+		return param;
 	}
 
 	template <typename T>
-	void ExpressionParser<T>::substitudeBracket(std::string & s, size_t index)
+	ValueRef<T> ExpressionParser<T>::parseNumber()
 	{
-		auto close = findClosingBracket(s, index, '(', ')');
-		if (close != std::string::npos)
+		auto text = tokenText();
+		T value = 0;
+
+		if (m_parseFunction)
+			value = m_parseFunction(std::string(text));
+		else
 		{
-			std::string inner = s.substr(index + 1, close - index - 1);
-			m_bracketHeap.push_back(inner);
-			std::string sub = "&" + (std::to_string(m_bracketHeap.size() - 1)) + ";";
-			s = s.substr(0, index) + sub + s.substr(close + 1);
+			//the token stops before any character strtod could take, so it reads the token only
+			const char * begin = m_source.data() + m_token.begin;
+			char * end = nullptr;
+			errno = 0;
+			if constexpr (std::is_integral_v<T>)
+			{
+				if (text.find_first_of(".eE") == std::string_view::npos)
+				{
+					if constexpr (std::is_signed_v<T>)
+						value = static_cast<T>(std::strtoll(begin, &end, 10));
+					else value = static_cast<T>(std::strtoull(begin, &end, 10));
+				}
+				else value = static_cast<T>(std::strtod(begin, &end));
+			}
+			else value = static_cast<T>(std::strtold(begin, &end));
+
+			if (end != begin + text.size() || errno == ERANGE)
+				error("Invalid number");
 		}
-		else throw std::invalid_argument("Bracket not closed!");
 
+		nextToken();
+		return std::make_unique<Number<T>>(value);
 	}
 
 	template <typename T>
-	size_t ExpressionParser<T>::findClosingBracket(std::string & s, size_t start, char openC, char closeC)
+	ValueRef<T> ExpressionParser<T>::parseFunction(std::string_view name)
 	{
-		size_t counter = 0;
-		for (size_t i = start; i < s.size(); i++)
+		auto function = m_functions.find(name);
+		auto builtin = m_builtins.find(name);
+
+		//the current token is the open bracket
+		nextToken();
+		std::vector<ValueRef<T>> values;
+		if (m_token.type != TokenType::CloseBracket)
 		{
-			if (s[i] == openC)
-				counter++;
-			if (s[i] == closeC)
-				counter--;
-			if (counter == 0)
-				return i;
+			values.push_back(parseLevel(0));
+			while (m_token.type == TokenType::Comma)
+			{
+				nextToken();
+				values.push_back(parseLevel(0));
+			}
 		}
-		return std::string::npos;
-	}
+		if (m_token.type != TokenType::CloseBracket)
+			error("Bracket not closed");
+		nextToken();
 
-	template <typename T>
-	bool ExpressionParser<T>::validIdentifier(std::string s)
-	{
-		trim(s);
-		if (s.empty())
-			return false;
-		if (s.size() < 1)
-			return false;
-		if (s.find(' ') != std::string::npos)
-			return false;
-		if (std::string("abcdefghijklmnopqrstuvwxyz").find(std::tolower(s[0])) == std::string::npos)
-			return false;
-		if (m_constants.find(s) != m_constants.end())
-			return false;
-		if (m_functions.find(s) != m_functions.end())
-			return false;
-		return true;
+		return std::make_unique<Function<T>>(function->first, function->second, values.begin(), values.end(), builtin == m_builtins.end() ? BuiltinFunction::None : builtin->second);
 	}
-}
\ No newline at end of file
+}
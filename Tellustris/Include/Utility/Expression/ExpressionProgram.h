@@ -0,0 +1,1148 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <type_traits>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+namespace NExpression
+{
+	template <typename T>
+	using ExpressionFunction = std::function<T(std::vector<T>)>;
+
+	//functions of the parser that the program can run without calling the ExpressionFunction
+	enum class BuiltinFunction
+	{
+		None,
+		Sqrt,
+		Ln,
+		Log,
+		Abs,
+		Sin,
+		Cos,
+		Tan,
+		Asin,
+		Acos,
+		Atan,
+		Atan2,
+		Min,
+		Max,
+		Clamp,
+		Rand,
+	};
+
+	enum class OpCode : unsigned char
+	{
+		Add,
+		Sub,
+		Mul,
+		Div,
+		Neg,
+		Pow,
+		Greater,
+		GreaterEqual,
+		Less,
+		LessEqual,
+		Equal,
+		NotEqual,
+		Not,
+		Bool,
+		And,
+		Or,
+		JumpIfZero,
+		JumpIfNotZero,
+		Sqrt,
+		Ln,
+		Log,
+		Abs,
+		Sin,
+		Cos,
+		Tan,
+		Asin,
+		Acos,
+		Atan,
+		Atan2,
+		Min,
+		Max,
+		Clamp,
+		Rand,
+		Call,
+	};
+
+	//registers[out] = op(registers[a], registers[b], registers[c])
+	//jumps go to the instruction c, Rand use c as argument count, Call as call index
+	struct Instruction
+	{
+		OpCode op;
+		unsigned int out;
+		unsigned int a;
+		unsigned int b;
+		unsigned int c;
+	};
+
+	/* programme a registres compile depuis l'arbre d'une Expression
+	 * registres : [0, parameterCount[ = parametres, puis constantes et temporaires
+	 * l'execution ne fait ni appel virtuel ni allocation, sauf pour les fonctions ajoutees par l'utilisateur
+	 * */
+	template <typename T>
+	class ExpressionProgram
+	{
+	public:
+		struct Call
+		{
+			ExpressionFunction<T> function;
+			std::vector<unsigned int> arguments;
+		};
+
+		bool empty() const { return m_instructions.empty() && m_registerCount == 0; }
+		size_t registerCount() const { return m_registerCount; }
+		size_t parameterCount() const { return m_parameterCount; }
+		size_t maxCallArguments() const { return m_maxCallArguments; }
+
+		bool isPure() const
+		{
+			return std::none_of(m_instructions.begin(), m_instructions.end(), [](const Instruction & ins) { return ins.op == OpCode::Rand || ins.op == OpCode::Call; });
+		}
+
+		//resize registers and write the constants, the parameters are set to 0
+		void initRegisters(std::vector<T> & registers) const
+		{
+			registers.assign(m_registerCount, T(0));
+			for (const auto & c : m_constants)
+				registers[c.first] = c.second;
+		}
+
+		//arguments is only used by the calls to user functions
+		T run(T * registers, std::vector<T> & arguments) const
+		{
+			if (m_registerCount == 0)
+				return T(0);
+
+			return runFrom(0, registers, arguments);
+		}
+
+		static constexpr size_t batchSize = 64;
+
+		/* run the program for count sets of parameters, batchSize at a time, one instruction on all of them at once
+		 * parameters[i] holds the count values of the parameter i, or is null to use registers[i] for all of them
+		 * registers are the registers of run(), only the parameters and the constants are read
+		 * */
+		void runBatch(const T * const * parameters, size_t count, T * out, const T * registers, std::vector<T> & batchRegisters, std::vector<T> & arguments) const
+		{
+			if (m_registerCount == 0)
+			{
+				std::fill(out, out + count, T(0));
+				return;
+			}
+
+			//registers of the block, register r of the element j at r * batchSize + j, then the registers of a single run
+			batchRegisters.resize(m_registerCount * (batchSize + 1));
+			T * batch = batchRegisters.data();
+			T * single = batch + m_registerCount * batchSize;
+
+			for (unsigned int i = 0; i < m_parameterCount; i++)
+				if (!parameters[i])
+					std::fill(batch + i * batchSize, batch + (i + 1) * batchSize, registers[i]);
+			for (const auto & c : m_constants)
+				std::fill(batch + c.first * batchSize, batch + (c.first + 1) * batchSize, c.second);
+
+			for (size_t start = 0; start < count; start += batchSize)
+			{
+				size_t size = std::min(batchSize, count - start);
+				for (unsigned int i = 0; i < m_parameterCount; i++)
+					if (parameters[i])
+						std::copy(parameters[i] + start, parameters[i] + start + size, batch + i * batchSize);
+
+				runBlock(batch, size, single, out + start, arguments);
+			}
+		}
+
+		//same behaviour as the rand function of the parser, with one engine per thread to run on the ThreadPool
+		static T random(T a, T b, unsigned int argumentCount)
+		{
+			thread_local std::mt19937 rand(std::random_device{}());
+
+			if constexpr (std::is_integral_v<T>)
+			{
+				if (argumentCount == 0)
+					return static_cast<T>(rand());
+			}
+
+			T min = 0;
+			T max = 1;
+			if (argumentCount == 1)
+			{
+				min = std::min(T(0), a);
+				max = std::max(T(0), a);
+			}
+			else if (argumentCount > 1)
+			{
+				min = std::min(a, b);
+				max = std::max(a, b);
+			}
+
+			if constexpr (std::is_integral_v<T>)
+				return std::uniform_int_distribution<T>(min, max)(rand);
+			else return std::uniform_real_distribution<T>(min, max)(rand);
+		}
+
+	private:
+		T runFrom(size_t start, T * registers, std::vector<T> & arguments) const
+		{
+			const Instruction * instructions = m_instructions.data();
+			const size_t size = m_instructions.size();
+
+			for (size_t i = start; i < size; i++)
+			{
+				const auto & ins = instructions[i];
+				T a = registers[ins.a];
+				T b = registers[ins.b];
+
+				switch (ins.op)
+				{
+				case OpCode::Add:
+					registers[ins.out] = a + b;
+					break;
+				case OpCode::Sub:
+					registers[ins.out] = a - b;
+					break;
+				case OpCode::Mul:
+					registers[ins.out] = a * b;
+					break;
+				case OpCode::Div:
+					registers[ins.out] = a / b;
+					break;
+				case OpCode::Neg:
+					registers[ins.out] = -a;
+					break;
+				case OpCode::Pow:
+					registers[ins.out] = static_cast<T>(std::pow(a, b));
+					break;
+				case OpCode::Greater:
+					registers[ins.out] = a > b;
+					break;
+				case OpCode::GreaterEqual:
+					registers[ins.out] = a >= b;
+					break;
+				case OpCode::Less:
+					registers[ins.out] = a < b;
+					break;
+				case OpCode::LessEqual:
+					registers[ins.out] = a <= b;
+					break;
+				case OpCode::Equal:
+					registers[ins.out] = a == b;
+					break;
+				case OpCode::NotEqual:
+					registers[ins.out] = a != b;
+					break;
+				case OpCode::Not:
+					registers[ins.out] = a == T(0) ? T(1) : T(0);
+					break;
+				case OpCode::Bool:
+					registers[ins.out] = a != T(0) ? T(1) : T(0);
+					break;
+				case OpCode::And:
+					registers[ins.out] = a != T(0) && b != T(0) ? T(1) : T(0);
+					break;
+				case OpCode::Or:
+					registers[ins.out] = a != T(0) || b != T(0) ? T(1) : T(0);
+					break;
+				case OpCode::JumpIfZero:
+					if (a == T(0))
+						i = ins.c - 1;
+					break;
+				case OpCode::JumpIfNotZero:
+					if (a != T(0))
+						i = ins.c - 1;
+					break;
+				case OpCode::Sqrt:
+					registers[ins.out] = static_cast<T>(std::sqrt(a));
+					break;
+				case OpCode::Ln:
+					registers[ins.out] = static_cast<T>(std::log(a));
+					break;
+				case OpCode::Log:
+					registers[ins.out] = static_cast<T>(std::log10(a));
+					break;
+				case OpCode::Abs:
+					if constexpr (std::is_signed_v<T>)
+						registers[ins.out] = static_cast<T>(std::abs(a));
+					else registers[ins.out] = a;
+					break;
+				case OpCode::Sin:
+					registers[ins.out] = static_cast<T>(std::sin(a));
+					break;
+				case OpCode::Cos:
+					registers[ins.out] = static_cast<T>(std::cos(a));
+					break;
+				case OpCode::Tan:
+					registers[ins.out] = static_cast<T>(std::tan(a));
+					break;
+				case OpCode::Asin:
+					registers[ins.out] = static_cast<T>(std::asin(a));
+					break;
+				case OpCode::Acos:
+					registers[ins.out] = static_cast<T>(std::acos(a));
+					break;
+				case OpCode::Atan:
+					registers[ins.out] = static_cast<T>(std::atan(a));
+					break;
+				case OpCode::Atan2:
+					registers[ins.out] = static_cast<T>(std::atan2(a, b));
+					break;
+				case OpCode::Min:
+					registers[ins.out] = std::min(a, b);
+					break;
+				case OpCode::Max:
+					registers[ins.out] = std::max(a, b);
+					break;
+				case OpCode::Clamp:
+					registers[ins.out] = std::min(std::max(a, b), registers[ins.c]);
+					break;
+				case OpCode::Rand:
+					registers[ins.out] = random(a, b, ins.c);
+					break;
+				case OpCode::Call:
+				{
+					const auto & call = m_calls[ins.c];
+					arguments.clear();
+					for (auto arg : call.arguments)
+						arguments.push_back(registers[arg]);
+					registers[ins.out] = call.function(arguments);
+					break;
+				}
+				}
+			}
+
+			return registers[m_result];
+		}
+
+		void runBlock(T * batch, size_t size, T * single, T * out, std::vector<T> & arguments) const
+		{
+			for (size_t i = 0; i < m_instructions.size(); i++)
+			{
+				const auto & ins = m_instructions[i];
+				T * r = batch + ins.out * batchSize;
+				const T * a = batch + ins.a * batchSize;
+				const T * b = batch + ins.b * batchSize;
+
+				auto unary = [&](auto f)
+				{
+					for (size_t j = 0; j < size; j++)
+						r[j] = static_cast<T>(f(a[j]));
+				};
+				auto binary = [&](auto f)
+				{
+					for (size_t j = 0; j < size; j++)
+						r[j] = static_cast<T>(f(a[j], b[j]));
+				};
+
+				switch (ins.op)
+				{
+				case OpCode::Add:
+					binary([](T x, T y) { return x + y; });
+					break;
+				case OpCode::Sub:
+					binary([](T x, T y) { return x - y; });
+					break;
+				case OpCode::Mul:
+					binary([](T x, T y) { return x * y; });
+					break;
+				case OpCode::Div:
+					binary([](T x, T y) { return x / y; });
+					break;
+				case OpCode::Neg:
+					unary([](T x) { return -x; });
+					break;
+				case OpCode::Pow:
+					binary([](T x, T y) { return std::pow(x, y); });
+					break;
+				case OpCode::Greater:
+					binary([](T x, T y) { return x > y; });
+					break;
+				case OpCode::GreaterEqual:
+					binary([](T x, T y) { return x >= y; });
+					break;
+				case OpCode::Less:
+					binary([](T x, T y) { return x < y; });
+					break;
+				case OpCode::LessEqual:
+					binary([](T x, T y) { return x <= y; });
+					break;
+				case OpCode::Equal:
+					binary([](T x, T y) { return x == y; });
+					break;
+				case OpCode::NotEqual:
+					binary([](T x, T y) { return x != y; });
+					break;
+				case OpCode::Not:
+					unary([](T x) { return x == T(0); });
+					break;
+				case OpCode::Bool:
+					unary([](T x) { return x != T(0); });
+					break;
+				case OpCode::And:
+					binary([](T x, T y) { return x != T(0) && y != T(0); });
+					break;
+				case OpCode::Or:
+					binary([](T x, T y) { return x != T(0) || y != T(0); });
+					break;
+				case OpCode::JumpIfZero:
+				case OpCode::JumpIfNotZero:
+				{
+					bool ifZero = ins.op == OpCode::JumpIfZero;
+					size_t jumping = 0;
+					for (size_t j = 0; j < size; j++)
+						jumping += (a[j] == T(0)) == ifZero;
+
+					if (jumping == size)
+						i = ins.c - 1;
+					if (jumping == 0 || jumping == size)
+						break;
+
+					//the elements don't take the same branch, each one finishes alone
+					for (size_t j = 0; j < size; j++)
+					{
+						for (unsigned int reg = 0; reg < m_registerCount; reg++)
+							single[reg] = batch[reg * batchSize + j];
+						out[j] = runFrom(i, single, arguments);
+					}
+					return;
+				}
+				case OpCode::Sqrt:
+					unary([](T x) { return std::sqrt(x); });
+					break;
+				case OpCode::Ln:
+					unary([](T x) { return std::log(x); });
+					break;
+				case OpCode::Log:
+					unary([](T x) { return std::log10(x); });
+					break;
+				case OpCode::Abs:
+					if constexpr (std::is_signed_v<T>)
+						unary([](T x) { return std::abs(x); });
+					else unary([](T x) { return x; });
+					break;
+				case OpCode::Sin:
+					unary([](T x) { return std::sin(x); });
+					break;
+				case OpCode::Cos:
+					unary([](T x) { return std::cos(x); });
+					break;
+				case OpCode::Tan:
+					unary([](T x) { return std::tan(x); });
+					break;
+				case OpCode::Asin:
+					unary([](T x) { return std::asin(x); });
+					break;
+				case OpCode::Acos:
+					unary([](T x) { return std::acos(x); });
+					break;
+				case OpCode::Atan:
+					unary([](T x) { return std::atan(x); });
+					break;
+				case OpCode::Atan2:
+					binary([](T x, T y) { return std::atan2(x, y); });
+					break;
+				case OpCode::Min:
+					binary([](T x, T y) { return std::min(x, y); });
+					break;
+				case OpCode::Max:
+					binary([](T x, T y) { return std::max(x, y); });
+					break;
+				case OpCode::Clamp:
+				{
+					const T * c = batch + ins.c * batchSize;
+					for (size_t j = 0; j < size; j++)
+						r[j] = std::min(std::max(a[j], b[j]), c[j]);
+					break;
+				}
+				case OpCode::Rand:
+					for (size_t j = 0; j < size; j++)
+						r[j] = random(a[j], b[j], ins.c);
+					break;
+				case OpCode::Call:
+				{
+					const auto & call = m_calls[ins.c];
+					for (size_t j = 0; j < size; j++)
+					{
+						arguments.clear();
+						for (auto arg : call.arguments)
+							arguments.push_back(batch[arg * batchSize + j]);
+						r[j] = call.function(arguments);
+					}
+					break;
+				}
+				}
+			}
+
+			const T * result = batch + m_result * batchSize;
+			std::copy(result, result + size, out);
+		}
+
+		template <typename U>
+		friend class ProgramBuilder;
+
+		std::vector<Instruction> m_instructions;
+		std::vector<Call> m_calls;
+		std::vector<std::pair<unsigned int, T>> m_constants;
+		unsigned int m_registerCount = 0;
+		unsigned int m_parameterCount = 0;
+		unsigned int m_result = 0;
+		size_t m_maxCallArguments = 0;
+	};
+
+	/* used by IValue::compile, each compile call returns the register holding the value of the node
+	 * le builder optimise pendant la compilation :
+	 * - une operation dont les operandes sont constants est calculee directement (jamais rand ni les fonctions utilisateur)
+	 * - les sommes et produits imbriques sont aplatis, leurs constantes regroupees (en entier seulement,
+	 *   en flottant l'ordre de l'arbre est garde pour avoir les memes arrondis)
+	 * - x^0, x^1, x^2 (et x^3, x^4 en entier, x^-1 en flottant) deviennent des multiplications ou une division
+	 * - une operation deja faite avec les memes operandes n'est pas refaite
+	 * build() retire ensuite les instructions dont le resultat n'est pas utilise et renumerote les registres
+	 * */
+	template <typename T>
+	class ProgramBuilder
+	{
+	public:
+		ProgramBuilder(const std::vector<std::string> & parameterNames)
+			: m_parameterNames(parameterNames)
+		{
+			m_program.m_parameterCount = static_cast<unsigned int>(parameterNames.size());
+			m_program.m_registerCount = m_program.m_parameterCount;
+			m_registers.resize(m_program.m_parameterCount);
+		}
+
+		unsigned int parameter(const std::string & name) const
+		{
+			auto it = std::find(m_parameterNames.begin(), m_parameterNames.end(), name);
+			assert(it != m_parameterNames.end());
+			return static_cast<unsigned int>(std::distance(m_parameterNames.begin(), it));
+		}
+
+		unsigned int constant(T value)
+		{
+			for (const auto & c : m_program.m_constants)
+				if (sameValue(c.second, value))
+					return c.first;
+
+			auto index = newRegister();
+			m_program.m_constants.emplace_back(index, value);
+			m_registers[index].isConstant = true;
+			m_registers[index].value = value;
+			m_registers[index].isBoolean = sameValue(value, T(0)) || value == T(1);
+			return index;
+		}
+
+		unsigned int emit(OpCode op, unsigned int a, unsigned int b = 0, unsigned int c = 0)
+		{
+			if (!isPure(op))
+			{
+				auto out = newRegister();
+				emitTo(op, out, a, b, c);
+				return out;
+			}
+
+			if (canFold(op, a, b, c))
+				return constant(fold(op, value(a), value(b), value(c)));
+
+			auto simplified = simplify(op, a, b);
+			if (simplified != noRegister)
+				return simplified;
+
+			if (isCommutative(op) && b < a)
+				std::swap(a, b);
+			auto key = std::make_tuple(op, a, b, c);
+			auto it = m_computed.find(key);
+			if (it != m_computed.end())
+				return it->second.first;
+
+			auto out = newRegister();
+			m_computed.emplace(key, std::make_pair(out, position()));
+			emitTo(op, out, a, b, c);
+			m_registers[out].hasDefinition = true;
+			m_registers[out].definition = m_program.m_instructions.back();
+			m_registers[out].isBoolean = isComparison(op);
+			return out;
+		}
+
+		unsigned int sum(const std::vector<unsigned int> & terms)
+		{
+			return associative(OpCode::Add, terms, T(0), m_sums);
+		}
+
+		unsigned int product(const std::vector<unsigned int> & terms)
+		{
+			return associative(OpCode::Mul, terms, T(1), m_products);
+		}
+
+		//index of the next instruction
+		unsigned int position() const
+		{
+			return static_cast<unsigned int>(m_program.m_instructions.size());
+		}
+
+		/* && et || : le cote droit (instructions a partir de rightStart) n'est evalue que si necessaire,
+		 * comme dans l'arbre. Si le cote droit ne peut ni planter ni avoir d'effet de bord,
+		 * il est evalue dans tous les cas, ce qui evite les sauts
+		 * */
+		unsigned int logical(bool isAnd, unsigned int left, unsigned int rightStart, unsigned int right)
+		{
+			if (m_registers[left].isConstant)
+			{
+				bool leftValue = value(left) != T(0);
+				//the right side is never evaluated
+				if (leftValue != isAnd)
+				{
+					discard(rightStart);
+					return constant(leftValue ? T(1) : T(0));
+				}
+				return emit(OpCode::Bool, right);
+			}
+
+			if (canSkipShortCircuit(rightStart))
+				return emit(isAnd ? OpCode::And : OpCode::Or, left, right);
+
+			//what the right side computes can't be reused after, it may not have run
+			forget(rightStart);
+
+			auto out = newRegister();
+			auto & instructions = m_program.m_instructions;
+			for (size_t i = rightStart; i < instructions.size(); i++)
+				if (isJump(instructions[i].op))
+					instructions[i].c += 2;
+
+			Instruction toBool{ OpCode::Bool, out, left, 0, 0 };
+			Instruction jump{ isAnd ? OpCode::JumpIfZero : OpCode::JumpIfNotZero, out, left, 0, 0 };
+			instructions.insert(instructions.begin() + rightStart, { toBool, jump });
+			emitTo(OpCode::Bool, out, right);
+			instructions[rightStart + 1].c = position();
+			m_registers[out].isBoolean = true;
+			return out;
+		}
+
+		unsigned int newRegister()
+		{
+			m_registers.emplace_back();
+			return m_program.m_registerCount++;
+		}
+
+		unsigned int function(BuiltinFunction builtin, const ExpressionFunction<T> & f, const std::vector<unsigned int> & args)
+		{
+			switch (builtin)
+			{
+			case BuiltinFunction::Sqrt:
+				return unary(OpCode::Sqrt, args);
+			case BuiltinFunction::Ln:
+				return unary(OpCode::Ln, args);
+			case BuiltinFunction::Log:
+				return unary(OpCode::Log, args);
+			case BuiltinFunction::Abs:
+				return unary(OpCode::Abs, args);
+			case BuiltinFunction::Sin:
+				return unary(OpCode::Sin, args);
+			case BuiltinFunction::Cos:
+				return unary(OpCode::Cos, args);
+			case BuiltinFunction::Tan:
+				return unary(OpCode::Tan, args);
+			case BuiltinFunction::Asin:
+				return unary(OpCode::Asin, args);
+			case BuiltinFunction::Acos:
+				return unary(OpCode::Acos, args);
+			case BuiltinFunction::Atan:
+				return unary(OpCode::Atan, args);
+			case BuiltinFunction::Atan2:
+				if (args.size() < 2)
+					return constant(T(0));
+				return emit(OpCode::Atan2, args[0], args[1]);
+			case BuiltinFunction::Min:
+			case BuiltinFunction::Max:
+			{
+				if (args.empty())
+					return constant(T(0));
+				auto value = args[0];
+				for (size_t i = 1; i < args.size(); i++)
+					value = emit(builtin == BuiltinFunction::Min ? OpCode::Min : OpCode::Max, value, args[i]);
+				return value;
+			}
+			case BuiltinFunction::Clamp:
+				if (args.empty())
+					return constant(T(0));
+				if (args.size() < 3)
+					return args[0];
+				return emit(OpCode::Clamp, args[0], args[1], args[2]);
+			case BuiltinFunction::Rand:
+				return emit(OpCode::Rand, args.size() > 0 ? args[0] : 0, args.size() > 1 ? args[1] : 0, static_cast<unsigned int>(std::min<size_t>(args.size(), 2)));
+			default:
+				break;
+			}
+
+			assert(f);
+			m_program.m_calls.push_back(typename ExpressionProgram<T>::Call{ f, args });
+			m_program.m_maxCallArguments = std::max(m_program.m_maxCallArguments, args.size());
+			return emit(OpCode::Call, 0, 0, static_cast<unsigned int>(m_program.m_calls.size() - 1));
+		}
+
+		ExpressionProgram<T> build(unsigned int result)
+		{
+			m_program.m_result = result;
+			removeUnused();
+			return std::move(m_program);
+		}
+
+	private:
+		static constexpr unsigned int noRegister = ~0u;
+
+		struct RegisterInfo
+		{
+			bool isConstant = false;
+			bool isBoolean = false;
+			bool hasDefinition = false;
+			T value = T(0);
+			Instruction definition;
+		};
+
+		using InstructionKey = std::tuple<OpCode, unsigned int, unsigned int, unsigned int>;
+
+		static bool isJump(OpCode op)
+		{
+			return op == OpCode::JumpIfZero || op == OpCode::JumpIfNotZero;
+		}
+
+		static bool isPure(OpCode op)
+		{
+			return !isJump(op) && op != OpCode::Rand && op != OpCode::Call;
+		}
+
+		static bool isCommutative(OpCode op)
+		{
+			//not min and max, they keep their first operand when the other one is nan or a zero of the other sign
+			return op == OpCode::Add || op == OpCode::Mul
+				|| op == OpCode::Equal || op == OpCode::NotEqual || op == OpCode::And || op == OpCode::Or;
+		}
+
+		static bool isComparison(OpCode op)
+		{
+			switch (op)
+			{
+			case OpCode::Greater:
+			case OpCode::GreaterEqual:
+			case OpCode::Less:
+			case OpCode::LessEqual:
+			case OpCode::Equal:
+			case OpCode::NotEqual:
+			case OpCode::Not:
+			case OpCode::Bool:
+			case OpCode::And:
+			case OpCode::Or:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		static unsigned int operandCount(OpCode op)
+		{
+			switch (op)
+			{
+			case OpCode::Neg:
+			case OpCode::Not:
+			case OpCode::Bool:
+			case OpCode::JumpIfZero:
+			case OpCode::JumpIfNotZero:
+			case OpCode::Sqrt:
+			case OpCode::Ln:
+			case OpCode::Log:
+			case OpCode::Abs:
+			case OpCode::Sin:
+			case OpCode::Cos:
+			case OpCode::Tan:
+			case OpCode::Asin:
+			case OpCode::Acos:
+			case OpCode::Atan:
+				return 1;
+			case OpCode::Clamp:
+				return 3;
+			case OpCode::Call:
+				return 0;
+			default:
+				return 2;
+			}
+		}
+
+		//registers read by the instruction
+		template <typename Func>
+		void forEachOperand(Instruction & ins, Func f)
+		{
+			if (ins.op == OpCode::Call)
+			{
+				for (auto & arg : m_program.m_calls[ins.c].arguments)
+					f(arg);
+				return;
+			}
+
+			auto count = operandCount(ins.op);
+			if (count > 0)
+				f(ins.a);
+			if (count > 1)
+				f(ins.b);
+			if (count > 2)
+				f(ins.c);
+		}
+
+		T value(unsigned int reg) const
+		{
+			return m_registers[reg].value;
+		}
+
+		//-0 and +0 are different constants, 1 / -0 is -inf
+		static bool sameValue(T a, T b)
+		{
+			if constexpr (std::is_floating_point_v<T>)
+				return std::memcmp(&a, &b, sizeof(T)) == 0;
+			else return a == b;
+		}
+
+		bool isValue(unsigned int reg, T v) const
+		{
+			return m_registers[reg].isConstant && sameValue(m_registers[reg].value, v);
+		}
+
+		bool canFold(OpCode op, unsigned int a, unsigned int b, unsigned int c) const
+		{
+			auto count = operandCount(op);
+			if (!m_registers[a].isConstant || (count > 1 && !m_registers[b].isConstant) || (count > 2 && !m_registers[c].isConstant))
+				return false;
+			//an integer division by 0 stays a runtime error
+			if constexpr (std::is_integral_v<T>)
+				if (op == OpCode::Div && value(b) == T(0))
+					return false;
+			return true;
+		}
+
+		//run the instruction on constant operands, with the same code as the program
+		static T fold(OpCode op, T a, T b, T c)
+		{
+			ExpressionProgram<T> program;
+			program.m_instructions.push_back(Instruction{ op, 3, 0, 1, 2 });
+			program.m_registerCount = 4;
+			program.m_result = 3;
+
+			T registers[4] = { a, b, c, T(0) };
+			std::vector<T> arguments;
+			return program.run(registers, arguments);
+		}
+
+		//return noRegister if the operation can't be replaced
+		unsigned int simplify(OpCode op, unsigned int a, unsigned int b)
+		{
+			const auto & defA = m_registers[a];
+
+			switch (op)
+			{
+			//with floats, x + 0 and 0 - x change the sign of a zero x
+			case OpCode::Add:
+				if constexpr (std::is_integral_v<T>)
+				{
+					if (isValue(a, T(0)))
+						return b;
+					if (isValue(b, T(0)))
+						return a;
+				}
+				break;
+			case OpCode::Sub:
+				if (isValue(b, T(0)))
+					return a;
+				if constexpr (std::is_integral_v<T>)
+					if (isValue(a, T(0)))
+						return emit(OpCode::Neg, b);
+				break;
+			case OpCode::Mul:
+				if (isValue(a, T(1)))
+					return b;
+				if (isValue(b, T(1)))
+					return a;
+				if constexpr (std::is_signed_v<T>)
+				{
+					if (isValue(a, T(-1)))
+						return emit(OpCode::Neg, b);
+					if (isValue(b, T(-1)))
+						return emit(OpCode::Neg, a);
+				}
+				//0 * inf isn't 0 with floats
+				if constexpr (std::is_integral_v<T>)
+					if (isValue(a, T(0)) || isValue(b, T(0)))
+						return constant(T(0));
+				break;
+			case OpCode::Div:
+				if (isValue(b, T(1)))
+					return a;
+				break;
+			case OpCode::Neg:
+				if (defA.hasDefinition && defA.definition.op == OpCode::Neg)
+					return defA.definition.a;
+				break;
+			case OpCode::Not:
+				if (defA.hasDefinition && defA.definition.op == OpCode::Not)
+					return emit(OpCode::Bool, defA.definition.a);
+				break;
+			case OpCode::Bool:
+				if (defA.isBoolean)
+					return a;
+				break;
+			case OpCode::And:
+			case OpCode::Or:
+			{
+				//only emitted when both sides can be evaluated, the constant side decides or is ignored
+				bool isAnd = op == OpCode::And;
+				for (auto side : { std::make_pair(a, b), std::make_pair(b, a) })
+				{
+					if (!m_registers[side.first].isConstant)
+						continue;
+					bool sideValue = value(side.first) != T(0);
+					if (sideValue != isAnd)
+						return constant(sideValue ? T(1) : T(0));
+					return emit(OpCode::Bool, side.second);
+				}
+				break;
+			}
+			case OpCode::Min:
+			case OpCode::Max:
+				if (a == b)
+					return a;
+				break;
+			case OpCode::Pow:
+			{
+				if (!m_registers[b].isConstant)
+					break;
+				T power = value(b);
+				if (power == T(0))
+					return constant(T(1));
+				if (power == T(1))
+					return a;
+				if (power == T(2))
+					return emit(OpCode::Mul, a, a);
+				//x * x * x isn't rounded like pow(x, 3) with floats
+				if constexpr (std::is_integral_v<T>)
+				{
+					if (power == T(3))
+						return emit(OpCode::Mul, emit(OpCode::Mul, a, a), a);
+					if (power == T(4))
+					{
+						auto square = emit(OpCode::Mul, a, a);
+						return emit(OpCode::Mul, square, square);
+					}
+				}
+				//not x^0.5 : pow(-inf, 0.5) is +inf, sqrt(-inf) is nan
+				if constexpr (std::is_floating_point_v<T>)
+					if (power == T(-1))
+						return emit(OpCode::Div, constant(T(1)), a);
+				break;
+			}
+			default:
+				break;
+			}
+
+			return noRegister;
+		}
+
+		//sums and products: the terms of the nested ones are merged, the constants are grouped at the end
+		//with floats the order of the tree is kept, regrouping would change the rounding: only the leading constants are folded
+		unsigned int associative(OpCode op, const std::vector<unsigned int> & terms, T neutral, std::map<unsigned int, std::vector<unsigned int>> & flattened)
+		{
+			if constexpr (std::is_floating_point_v<T>)
+				return ordered(op, terms, neutral);
+
+			std::vector<unsigned int> values;
+			T constantPart = neutral;
+
+			auto add = [&](unsigned int term)
+			{
+				if (m_registers[term].isConstant)
+					constantPart = fold(op, constantPart, value(term), T(0));
+				else values.push_back(term);
+			};
+
+			for (auto term : terms)
+			{
+				auto it = flattened.find(term);
+				if (it == flattened.end())
+				{
+					add(term);
+					continue;
+				}
+				for (auto t : it->second)
+					add(t);
+			}
+
+			if (op == OpCode::Mul && constantPart == T(0))
+				return constant(T(0));
+
+			if (values.empty() || constantPart != neutral)
+				values.push_back(constant(constantPart));
+
+			auto result = values[0];
+			for (size_t i = 1; i < values.size(); i++)
+				result = emit(op, result, values[i]);
+
+			if (values.size() > 1)
+				flattened[result] = values;
+			return result;
+		}
+
+		//same operations as the tree, neutral op t0 op t1 ...
+		unsigned int ordered(OpCode op, const std::vector<unsigned int> & terms, T neutral)
+		{
+			T constantPart = neutral;
+			size_t first = 0;
+			for (; first < terms.size() && m_registers[terms[first]].isConstant; first++)
+				constantPart = fold(op, constantPart, value(terms[first]), T(0));
+
+			//1 * x is always x, but 0 + x is +0 when x is -0
+			if (first == terms.size() || op == OpCode::Add || !sameValue(constantPart, neutral))
+			{
+				auto result = constant(constantPart);
+				for (size_t i = first; i < terms.size(); i++)
+					result = emit(op, result, terms[i]);
+				return result;
+			}
+
+			auto result = terms[first];
+			for (size_t i = first + 1; i < terms.size(); i++)
+				result = emit(op, result, terms[i]);
+			return result;
+		}
+
+		void emitTo(OpCode op, unsigned int out, unsigned int a, unsigned int b = 0, unsigned int c = 0)
+		{
+			m_program.m_instructions.push_back(Instruction{ op, out, a, b, c });
+		}
+
+		//the operations done from the instruction start are not reused anymore
+		void forget(unsigned int start)
+		{
+			for (auto it = m_computed.begin(); it != m_computed.end();)
+			{
+				if (it->second.second >= start)
+					it = m_computed.erase(it);
+				else ++it;
+			}
+		}
+
+		void discard(unsigned int start)
+		{
+			forget(start);
+			m_program.m_instructions.resize(start);
+		}
+
+		bool canSkipShortCircuit(unsigned int start) const
+		{
+			const auto & instructions = m_program.m_instructions;
+			for (size_t i = start; i < instructions.size(); i++)
+			{
+				auto op = instructions[i].op;
+				if (!isPure(op))
+					return false;
+				//integer division by 0 and float to int conversions of nan can't be evaluated blindly
+				if constexpr (std::is_integral_v<T>)
+					if (op == OpCode::Div || op == OpCode::Sqrt || op == OpCode::Ln || op == OpCode::Log || op == OpCode::Pow
+						|| op == OpCode::Asin || op == OpCode::Acos || op == OpCode::Tan)
+						return false;
+			}
+			return true;
+		}
+
+		unsigned int unary(OpCode op, const std::vector<unsigned int> & args)
+		{
+			if (args.empty())
+				return constant(T(0));
+			return emit(op, args[0]);
+		}
+
+		//dead code removal, then the registers still used are packed after the parameters
+		void removeUnused()
+		{
+			auto & instructions = m_program.m_instructions;
+			std::vector<bool> usedRegisters(m_program.m_registerCount, false);
+			std::vector<bool> kept(instructions.size(), false);
+			usedRegisters[m_program.m_result] = true;
+
+			//the jumps only go forward, going backward almost always finish in one pass
+			bool changed = true;
+			while (changed)
+			{
+				changed = false;
+				for (size_t i = instructions.size(); i-- > 0;)
+				{
+					auto & ins = instructions[i];
+					if (kept[i] || (isPure(ins.op) && !usedRegisters[ins.out]))
+						continue;
+					kept[i] = true;
+					changed = true;
+					forEachOperand(ins, [&](unsigned int & reg) { usedRegisters[reg] = true; });
+				}
+			}
+
+			std::vector<unsigned int> newPositions(instructions.size() + 1);
+			std::vector<Instruction> keptInstructions;
+			std::vector<typename ExpressionProgram<T>::Call> keptCalls;
+			for (size_t i = 0; i < instructions.size(); i++)
+			{
+				newPositions[i] = static_cast<unsigned int>(keptInstructions.size());
+				if (!kept[i])
+					continue;
+				keptInstructions.push_back(instructions[i]);
+				if (instructions[i].op == OpCode::Call)
+				{
+					keptCalls.push_back(m_program.m_calls[instructions[i].c]);
+					keptInstructions.back().c = static_cast<unsigned int>(keptCalls.size() - 1);
+				}
+			}
+			newPositions[instructions.size()] = static_cast<unsigned int>(keptInstructions.size());
+			instructions = std::move(keptInstructions);
+			m_program.m_calls = std::move(keptCalls);
+
+			std::vector<unsigned int> newRegisters(m_program.m_registerCount, noRegister);
+			unsigned int registerCount = m_program.m_parameterCount;
+			for (unsigned int i = 0; i < m_program.m_parameterCount; i++)
+				newRegisters[i] = i;
+			auto remap = [&](unsigned int & reg)
+			{
+				if (newRegisters[reg] == noRegister)
+					newRegisters[reg] = registerCount++;
+				reg = newRegisters[reg];
+			};
+
+			for (auto & ins : instructions)
+			{
+				if (isJump(ins.op))
+					ins.c = newPositions[ins.c];
+				remap(ins.out);
+				forEachOperand(ins, remap);
+			}
+			remap(m_program.m_result);
+
+			std::vector<std::pair<unsigned int, T>> constants;
+			for (const auto & c : m_program.m_constants)
+				if (newRegisters[c.first] != noRegister)
+					constants.emplace_back(newRegisters[c.first], c.second);
+			m_program.m_constants = std::move(constants);
+			m_program.m_registerCount = registerCount;
+		}
+
+		const std::vector<std::string> & m_parameterNames;
+		ExpressionProgram<T> m_program;
+		std::vector<RegisterInfo> m_registers;
+		std::map<InstructionKey, std::pair<unsigned int, unsigned int>> m_computed;
+		std::map<unsigned int, std::vector<unsigned int>> m_sums;
+		std::map<unsigned int, std::vector<unsigned int>> m_products;
+	};
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ExpressionProgram.h"
+
 #include <string>
 #include <vector>
 #include <memory>
@@ -13,9 +15,6 @@ namespace NExpression
 	template <typename T>
 	using ValueRef = std::unique_ptr<IValue<T>>;
 
-	template <typename T>
-	class Expression;
-
 	template <typename T>
 	class IValue
 	{
@@ -30,7 +29,8 @@ namespace NExpression
 
 		virtual ValueRef<T> clone() const = 0;
 
-		virtual void registerParameter(Expression<T> & expression) = 0;
+		//emit the instructions of the node, return the register of the result
+		virtual unsigned int compile(ProgramBuilder<T> & builder) const = 0;
 	};
 
 	template <typename T>
@@ -59,7 +59,10 @@ namespace NExpression
 			return std::make_unique<Number<T>>(m_value);
 		}
 
-		void registerParameter(Expression<T> &) override {}
+		unsigned int compile(ProgramBuilder<T> & builder) const override
+		{
+			return builder.constant(m_value);
+		}
 
 	protected:
 		T m_value;
@@ -92,10 +95,10 @@ namespace NExpression
 			v->set(Number<T>::m_value);
 			return v;
 		}
-		
-		void registerParameter(Expression<T> & expression) override
+
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			expression.addParameter(this);
+			return builder.parameter(m_name);
 		}
 
 	private:
@@ -143,10 +146,13 @@ namespace NExpression
 			return std::make_unique<OperationSum<T>>(values.begin(), values.end());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			for (auto & v : m_values)
-				v->registerParameter(expression);
+			std::vector<unsigned int> terms;
+			terms.reserve(m_values.size());
+			for (const auto & v : m_values)
+				terms.push_back(v->compile(builder));
+			return builder.sum(terms);
 		}
 
 	private:
@@ -178,9 +184,9 @@ namespace NExpression
 			return std::make_unique<OperationNegate<T>>(m_value->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_value->registerParameter(expression);
+			return builder.emit(OpCode::Neg, m_value->compile(builder));
 		}
 
 	private:
@@ -228,10 +234,13 @@ namespace NExpression
 			return std::make_unique<OperationProduct<T>>(values.begin(), values.end());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			for (auto & v : m_values)
-				v->registerParameter(expression);
+			std::vector<unsigned int> terms;
+			terms.reserve(m_values.size());
+			for (const auto & v : m_values)
+				terms.push_back(v->compile(builder));
+			return builder.product(terms);
 		}
 
 	private:
@@ -280,10 +289,12 @@ namespace NExpression
 			return std::make_unique<OperationReciprocal<T>>(values.begin(), values.end());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			for (auto & v : m_values)
-				v->registerParameter(expression);
+			auto value = m_values[0]->compile(builder);
+			for (size_t i = 1; i < m_values.size(); i++)
+				value = builder.emit(OpCode::Div, value, m_values[i]->compile(builder));
+			return value;
 		}
 
 	private:
@@ -316,10 +327,10 @@ namespace NExpression
 			return std::make_unique<OperationPower<T>>(m_value->clone(), m_power->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_value->registerParameter(expression);
-			m_power->registerParameter(expression);
+			auto value = m_value->compile(builder);
+			return builder.emit(OpCode::Pow, value, m_power->compile(builder));
 		}
 
 	private:
@@ -353,24 +364,25 @@ namespace NExpression
 			return std::make_unique<Constant<T>>(m_name, m_value);
 		}
 
-		void registerParameter(Expression<T> & expression) override {};
+		unsigned int compile(ProgramBuilder<T> & builder) const override
+		{
+			return builder.constant(m_value);
+		}
 
 	private:
 		std::string m_name;
 		T m_value;
 	};
 
-	template <typename T>
-	using ExpressionFunction = std::function<T(std::vector<T>)>;
-
 	template <typename T>
 	class Function : public IValue<T>
 	{
 	public:
 		template <typename iterator>
-		Function(const std::string & functionName, ExpressionFunction<T> f, iterator begin, iterator end)
+		Function(const std::string & functionName, ExpressionFunction<T> f, iterator begin, iterator end, BuiltinFunction builtin = BuiltinFunction::None)
 			: m_functionName(functionName)
 			, m_function(f)
+			, m_builtin(builtin)
 		{
 			auto size = std::distance(begin, end);
 			m_values.reserve(size);
@@ -405,18 +417,22 @@ namespace NExpression
 			std::vector<ValueRef<T>> values;
 			for (const auto & v : m_values)
 				values.emplace_back(v->clone());
-			return std::make_unique<Function<T>>(m_functionName, m_function, values.begin(), values.end());
+			return std::make_unique<Function<T>>(m_functionName, m_function, values.begin(), values.end(), m_builtin);
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			for (auto & v : m_values)
-				v->registerParameter(expression);
+			std::vector<unsigned int> args;
+			args.reserve(m_values.size());
+			for (const auto & v : m_values)
+				args.push_back(v->compile(builder));
+			return builder.function(m_builtin, m_function, args);
 		}
 
 	private:
 		std::string m_functionName;
 		ExpressionFunction<T> m_function;
+		BuiltinFunction m_builtin;
 		std::vector<ValueRef<T>> m_values;
 	};
 
@@ -446,10 +462,10 @@ namespace NExpression
 			return std::make_unique<ComparisonSup<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			return builder.emit(OpCode::Greater, left, m_right->compile(builder));
 		}
 
 	private:
@@ -483,10 +499,10 @@ namespace NExpression
 			return std::make_unique<ComparisonSupOrEqual<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			return builder.emit(OpCode::GreaterEqual, left, m_right->compile(builder));
 		}
 
 	private:
@@ -520,10 +536,10 @@ namespace NExpression
 			return std::make_unique<ComparisonSub<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			return builder.emit(OpCode::Less, left, m_right->compile(builder));
 		}
 
 	private:
@@ -557,10 +573,10 @@ namespace NExpression
 			return std::make_unique<ComparisonSubOrEqual<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			return builder.emit(OpCode::LessEqual, left, m_right->compile(builder));
 		}
 
 	private:
@@ -594,10 +610,10 @@ namespace NExpression
 			return std::make_unique<ComparisonEqual<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			return builder.emit(OpCode::Equal, left, m_right->compile(builder));
 		}
 
 	private:
@@ -631,10 +647,10 @@ namespace NExpression
 			return std::make_unique<ComparisonUnequal<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			return builder.emit(OpCode::NotEqual, left, m_right->compile(builder));
 		}
 
 	private:
@@ -668,10 +684,11 @@ namespace NExpression
 			return std::make_unique<ConditionOr<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			auto rightStart = builder.position();
+			return builder.logical(false, left, rightStart, m_right->compile(builder));
 		}
 
 	private:
@@ -705,10 +722,11 @@ namespace NExpression
 			return std::make_unique<ConditionAnd<T>>(m_left->clone(), m_right->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_left->registerParameter(expression);
-			m_right->registerParameter(expression);
+			auto left = m_left->compile(builder);
+			auto rightStart = builder.position();
+			return builder.logical(true, left, rightStart, m_right->compile(builder));
 		}
 
 	private:
@@ -742,9 +760,9 @@ namespace NExpression
 			return std::make_unique<ConditionNot<T>>(m_value->clone());
 		}
 
-		void registerParameter(Expression<T> & expression) override
+		unsigned int compile(ProgramBuilder<T> & builder) const override
 		{
-			m_value->registerParameter(expression);
+			return builder.emit(OpCode::Not, m_value->compile(builder));
 		}
 
 	private:
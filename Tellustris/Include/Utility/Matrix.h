@@ -1,17 +1,18 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 #include <cassert>
 
-template <typename T>
+template <typename T, typename Allocator = std::allocator<T>>
 class Matrix
 {
 public:
 
-	using reference = typename std::vector<T>::reference;
-	using const_reference = typename std::vector<T>::const_reference;
-	using iterator = typename std::vector<T>::iterator;
-	using const_iterator = typename std::vector<T>::const_iterator;
+	using reference = typename std::vector<T, Allocator>::reference;
+	using const_reference = typename std::vector<T, Allocator>::const_reference;
+	using iterator = typename std::vector<T, Allocator>::iterator;
+	using const_iterator = typename std::vector<T, Allocator>::const_iterator;
 
 	Matrix(size_t width, size_t height, T defaultValue = T())
 		: m_datas(width*height, defaultValue)
@@ -77,7 +78,7 @@ public:
 	}
 
 private:
-	std::vector<T> m_datas;
+	std::vector<T, Allocator> m_datas;
 	size_t m_width;
 	size_t m_height;
 };
\ No newline at end of file
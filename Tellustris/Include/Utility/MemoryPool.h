@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <memory>
+
+/* pool d'objets de taille fixe, alloues par blocs, les emplacements liberes sont chaines entre eux
+ * la memoire des blocs n'est jamais rendue avant la destruction du pool : apres un pic,
+ * creer et detruire autant d'objets ne fait plus d'allocation
+ * les pools partages (forSize) sont par classe de taille, ceux de PoolAllocated par type,
+ * aucun n'est jamais detruit, un objet peut donc etre libere pendant la destruction des statiques
+ * */
+class MemoryPool
+{
+public:
+	struct Statistics
+	{
+		size_t liveCount; //objects allocated and not freed
+		size_t highWaterMark; //max of liveCount
+		size_t capacity; //objects that fit in the blocks
+	};
+
+	static constexpr size_t granularity = 16; //sizes up to smallSizeMax are rounded to it, then to the next power of 2
+	static constexpr size_t smallSizeMax = 1024;
+	static constexpr size_t maxPooledSize = 64 * 1024;
+	static constexpr size_t blockBytes = 64 * 1024;
+
+	explicit MemoryPool(size_t objectSize);
+	MemoryPool(const MemoryPool &) = delete;
+	MemoryPool & operator=(const MemoryPool &) = delete;
+	~MemoryPool();
+
+	void * allocate();
+	void deallocate(void * object);
+
+	size_t objectSize() const { return m_objectSize; }
+	Statistics statistics() const;
+
+	//the shared pool of the size class of size, nullptr over maxPooledSize
+	static MemoryPool * forSize(size_t size);
+	//from the shared pools, or from the global operator new over maxPooledSize
+	static void * allocate(size_t size);
+	static void deallocate(void * object, size_t size);
+
+private:
+	static size_t sizeClass(size_t size);
+
+	size_t m_objectSize;
+	size_t m_objectsPerBlock;
+	std::vector<void *> m_blocks;
+	void * m_freeList = nullptr; //each free slot begins with the address of the next one
+
+	size_t m_liveCount = 0;
+	size_t m_highWaterMark = 0;
+
+	mutable std::mutex m_mutex; //the chunks and their layers can be created by the workers
+};
+
+/* base class of T, its objects are allocated from a pool of their own, pool().statistics() counts only them
+ * a class derived from T that doesn't have its own PoolAllocated uses the shared pools, its size is different
+ * the pool is never destroyed, like the shared ones
+ * */
+template <typename T>
+class PoolAllocated
+{
+public:
+	static void * operator new(size_t size)
+	{
+		if (size != sizeof(T))
+			return MemoryPool::allocate(size);
+		return pool().allocate();
+	}
+
+	static void operator delete(void * object, size_t size)
+	{
+		if (size != sizeof(T))
+			MemoryPool::deallocate(object, size);
+		else pool().deallocate(object);
+	}
+
+	static MemoryPool & pool()
+	{
+		static MemoryPool * p = new MemoryPool(sizeof(T));
+		return *p;
+	}
+};
+
+//allocator of the standard containers using the shared pools
+template <typename T>
+class PoolAllocator
+{
+public:
+	using value_type = T;
+
+	PoolAllocator() = default;
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U> &) {}
+
+	T * allocate(size_t count) { return static_cast<T *>(MemoryPool::allocate(count * sizeof(T))); }
+	void deallocate(T * p, size_t count) { MemoryPool::deallocate(p, count * sizeof(T)); }
+
+	template <typename U>
+	bool operator==(const PoolAllocator<U> &) const { return true; }
+	template <typename U>
+	bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/* bruit simplex a gradients, periodique sur size comme Perlin/Perlin2D
+ * size : periode de la texture, frequence : nombre de cellules sur une periode
+ * le resultat est compris entre -amplitude et amplitude
+ *
+ * 2D and 3D use the sheared lattices from Gustavson & McEwan's psrdnoise, which
+ * stay simplex-like while being exactly tileable on axis aligned periods.
+ * In 2D the vertical period must be even, an odd frequence is rounded up on y.
+ * No tables are used, corners gradients come from an integer hash of the wrapped
+ * lattice coordinates. The evaluation is branchless so the batch versions can be
+ * auto vectorized.
+ * */
+class Simplex
+{
+public:
+	Simplex(size_t size, float amplitude, size_t frequence, size_t seed);
+
+	float operator()(float x, float y) const;
+	float operator()(float x, float y, float z) const;
+
+	//out[i] = (*this)(x[i], y[i])
+	void operator()(const float * x, const float * y, float * out, size_t count) const;
+	//out[i] = (*this)(x[i], y[i], z[i])
+	void operator()(const float * x, const float * y, const float * z, float * out, size_t count) const;
+
+	size_t size() const { return m_size; }
+	float amplitude() const { return m_amplitude; }
+	size_t frequence() const { return m_frequence; }
+
+private:
+	size_t m_size;
+	float m_amplitude;
+	size_t m_frequence;
+
+	float m_scaleX;
+	float m_scaleY;
+	float m_period;
+	float m_periodY;
+	uint32_t m_seed;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/* pool de threads a vol de taches
+ * chaque worker a sa propre file, un worker sans travail vole les taches des autres files
+ * le thread appelant de parallelFor participe au travail jusqu'a la fin de la boucle,
+ * un parallelFor peut donc etre lance depuis une tache sans bloquer le pool
+ * */
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	//threadCount workers are created, the calling thread is the extra one
+	explicit ThreadPool(size_t threadCount);
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+	~ThreadPool();
+
+	size_t threadCount() const { return m_threads.size(); }
+
+	//call function(i) for each i in [0;count[, blocks of grain indexs are distributed over the workers
+	//if function throws, the blocks not started yet are skipped and the first exception is rethrown here
+	void parallelFor(size_t count, const std::function<void(size_t)> & function, size_t grain = 1);
+
+	//one pool for the whole application, hardware_concurrency - 1 workers
+	static ThreadPool & global();
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void push(size_t workerIndex, Task task);
+	bool pop(size_t workerIndex, Task & task);
+	bool steal(size_t workerIndex, Task & task);
+	void run(size_t workerIndex);
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+	std::atomic<size_t> m_pendingTasks;
+	bool m_stop;
+};
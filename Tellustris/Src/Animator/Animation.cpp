@@ -1,20 +1,69 @@
 #include "Animator/Animation.h"
+#include "Animator/CompiledAnimator.h"
 
+#include <algorithm>
 #include <cassert>
 
 Animation::Animation(bool _loop)
-	: loop(_loop)
+	: m_loop(_loop)
 {
 
 }
 
-float Animation::duration() const
+void Animation::push_back(const Frame & frame)
 {
-	float time = 0;
+	std::vector<Frame>::push_back(frame);
+	updateFrameEnds(size() - 1);
+}
+
+void Animation::pop_back()
+{
+	std::vector<Frame>::pop_back();
+	m_frameEnds.pop_back();
+	changed();
+}
 
-	for (const auto & f : *this)
-		time += f.time;
-	return time;
+void Animation::insert(size_t index, const Frame & frame)
+{
+	assert(index <= size());
+	std::vector<Frame>::insert(std::vector<Frame>::begin() + index, frame);
+	updateFrameEnds(index);
+}
+
+void Animation::erase(size_t index)
+{
+	assert(index < size());
+	std::vector<Frame>::erase(std::vector<Frame>::begin() + index);
+	updateFrameEnds(index);
+}
+
+void Animation::clear()
+{
+	std::vector<Frame>::clear();
+	m_frameEnds.clear();
+	changed();
+}
+
+void Animation::setFrame(size_t index, const Frame & frame)
+{
+	assert(index < size());
+	std::vector<Frame>::operator[](index) = frame;
+	updateFrameEnds(index);
+}
+
+void Animation::setLoop(bool loop)
+{
+	if (m_loop == loop)
+		return;
+	m_loop = loop;
+	changed();
+}
+
+float Animation::duration() const
+{
+	if (m_frameEnds.empty())
+		return 0;
+	return m_frameEnds.back();
 }
 
 Nz::Recti Animation::bounds() const
@@ -42,23 +91,46 @@ Nz::Recti Animation::bounds() const
 }
 
 
-Frame Animation::current(float time, bool checkLoop)
+size_t Animation::frameIndex(float time) const
+{
+	assert(!empty());
+
+	//first frame that ends after time
+	auto it = std::lower_bound(m_frameEnds.begin(), m_frameEnds.end(), time);
+	if (it == m_frameEnds.end())
+		return size() - 1;
+	return static_cast<size_t>(it - m_frameEnds.begin());
+}
+
+const Frame & Animation::current(float time, bool checkLoop) const
 {
 	assert(!empty());
 	float totalTime = duration();
 
 	if (checkLoop && time > totalTime)
 	{
-		if (!loop)
+		if (!m_loop)
 			time = totalTime;
 		else time = fmod(time, totalTime);
 	}
 
-	for (const auto & f : *this)
+	return (*this)[frameIndex(time)];
+}
+
+void Animation::updateFrameEnds(size_t from)
+{
+	m_frameEnds.resize(size());
+	float time = from == 0 ? 0 : m_frameEnds[from - 1];
+	for (size_t i = from; i < size(); i++)
 	{
-		time -= f.time;
-		if (time <= 0)
-			return f;
+		time += (*this)[i].time;
+		m_frameEnds[i] = time;
 	}
-	return back();
+	changed();
+}
+
+void Animation::changed()
+{
+	m_version++;
+	CompiledAnimator::sourceChanged();
 }
@@ -15,6 +15,7 @@ Animator::Animator(AnimationRef anim, const std::string & animName, bool xFlippe
 unsigned int Animator::addAnimation(const std::string & name, AnimationRef anim, bool xFlipped, bool yFlipped)
 {
 	assert(!animationExist(name));
+	invalidate();
 
 	m_states.push_back({ name, anim, xFlipped, yFlipped, {} });
 	return static_cast<unsigned int>(m_states.size() - 1);
@@ -28,6 +29,7 @@ void Animator::removeAnimation(const std::string & name)
 void Animator::removeAnimation(unsigned int index)
 {
 	assert(animationExist(index));
+	invalidate();
 
 	m_transitions.erase(std::remove_if(m_transitions.begin(), m_transitions.end(), [index](const auto t)
 	{
@@ -97,12 +99,12 @@ bool Animator::animationExist(unsigned int index) const
 	return index <= m_states.size();
 }
 
-AnimationRef Animator::animation(const std::string & name) const
+const AnimationRef & Animator::animation(const std::string & name) const
 {
 	return animation(animationIndex(name));
 }
 
-AnimationRef Animator::animation(unsigned int index) const
+const AnimationRef & Animator::animation(unsigned int index) const
 {
 	assert(animationExist(index));
 	return m_states[index].animation;
@@ -116,6 +118,7 @@ void Animator::setAnimation(const std::string & name, AnimationRef animation)
 void Animator::setAnimation(unsigned int index, AnimationRef animation)
 {
 	assert(animationExist(index));
+	invalidate();
 	m_states[index].animation = animation;
 }
 
@@ -138,6 +141,7 @@ void Animator::setAnimationXFlipped(const std::string & name, bool flipped)
 void Animator::setAnimationXFlipped(unsigned int index, bool flipped)
 {
 	assert(animationExist(index));
+	invalidate();
 	m_states[index].xFlipped = flipped;
 }
 
@@ -160,6 +164,7 @@ void Animator::setAnimationYFlipped(const std::string & name, bool flipped)
 void Animator::setAnimationYFlipped(unsigned int index, bool flipped)
 {
 	assert(animationExist(index));
+	invalidate();
 	m_states[index].yFlipped = flipped;
 }
 
@@ -181,6 +186,7 @@ void Animator::setDefaultAnimation(const std::string & name)
 void Animator::setDefaultAnimation(unsigned int index)
 {
 	assert(animationExist(index));
+	invalidate();
 	m_defaultStateIndex = index;
 }
 
@@ -199,6 +205,7 @@ unsigned int Animator::addTransition(unsigned int fromState, unsigned int toStat
 	assert(!haveTransition(fromState, toState));
 	assert(animationExist(fromState));
 	assert(animationExist(toState));
+	invalidate();
 
 	ConditionExpressionParser parser;
 	m_transitions.push_back({ fromState, toState, condition, parser.evaluate(condition) });
@@ -211,6 +218,7 @@ unsigned int Animator::addTransition(unsigned int fromState, unsigned int toStat
 	assert(!haveTransition(fromState, toState));
 	assert(animationExist(fromState));
 	assert(animationExist(toState));
+	invalidate();
 
 	m_transitions.push_back({ fromState, toState, expression.toString(), expression });
 	m_states[fromState].transitionIndexs.push_back(static_cast<unsigned int>(m_transitions.size() - 1));
@@ -225,6 +233,7 @@ void Animator::removeTransition(const std::string & fromState, const std::string
 void Animator::removeTransition(unsigned int fromState, unsigned int toState)
 {
 	assert(haveTransition(fromState, toState));
+	invalidate();
 
 	auto index = getTransition(fromState, toState);
 	m_transitions.erase(m_transitions.begin() + index);
@@ -267,12 +276,12 @@ unsigned int Animator::transitionsCount() const
 	return static_cast<unsigned int>(m_transitions.size());
 }
 
-std::vector<unsigned int> Animator::outStateTransitionsIndexs(const std::string & state) const
+const std::vector<unsigned int> & Animator::outStateTransitionsIndexs(const std::string & state) const
 {
 	return outStateTransitionsIndexs(animationIndex(state));
 }
 
-std::vector<unsigned int> Animator::outStateTransitionsIndexs(unsigned int stateIndex) const
+const std::vector<unsigned int> & Animator::outStateTransitionsIndexs(unsigned int stateIndex) const
 {
 	assert(animationExist(stateIndex));
 
@@ -317,7 +326,7 @@ std::string Animator::transitionConditionString(unsigned int index) const
 	return m_transitions[index].condition;
 }
 
-ConditionExpression Animator::transitionConditionExpression(unsigned int index) const
+const ConditionExpression & Animator::transitionConditionExpression(unsigned int index) const
 {
 	assert(index < m_transitions.size());
 
@@ -327,6 +336,7 @@ ConditionExpression Animator::transitionConditionExpression(unsigned int index)
 void Animator::setTransitionCondition(unsigned int index, const std::string & condition)
 {
 	assert(index < m_transitions.size());
+	invalidate();
 
 	m_transitions[index].condition = condition;
 	ConditionExpressionParser parser;
@@ -336,7 +346,21 @@ void Animator::setTransitionCondition(unsigned int index, const std::string & co
 void Animator::setTransitionCondition(unsigned int index, const ConditionExpression & expression)
 {
 	assert(index < m_transitions.size());
+	invalidate();
 
 	m_transitions[index].condition = expression.toString();
 	m_transitions[index].expression = expression;
 }
+
+CompiledAnimatorConstRef Animator::compile() const
+{
+	if (!m_compiled || m_compiled->isOutdated(*this))
+		m_compiled = CompiledAnimator::New(*this);
+	return m_compiled;
+}
+
+void Animator::invalidate()
+{
+	m_compiled.Reset();
+	CompiledAnimator::sourceChanged();
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+
+#include "Animator/CompiledAnimator.h"
+#include "Animator/Animator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	CompiledAnimator::SpriteFrame makeSpriteFrame(const Frame & frame, bool xFlipped, bool yFlipped)
+	{
+		CompiledAnimator::SpriteFrame spriteFrame;
+
+		Nz::Rectf rect(static_cast<float>(frame.rect.x), static_cast<float>(frame.rect.y), static_cast<float>(frame.rect.width), static_cast<float>(frame.rect.height));
+		if (xFlipped)
+		{
+			rect.width *= -1;
+			rect.x -= rect.width;
+		}
+		if (yFlipped)
+		{
+			rect.height *= -1;
+			rect.y -= rect.height;
+		}
+
+		spriteFrame.textureRect = rect;
+		spriteFrame.size = Nz::Vector2f(static_cast<float>(frame.rect.width), static_cast<float>(frame.rect.height));
+		spriteFrame.origin = Nz::Vector3f(static_cast<float>(frame.offset.x), static_cast<float>(frame.offset.y), 0);
+		return spriteFrame;
+	}
+}
+
+const char * const CompiledAnimator::defaultPropertyNames[CompiledAnimator::defaultPropertyCount] = { "time", "timeSingle", "finished", "loops" };
+
+CompiledAnimator::CompiledAnimator(const Animator & animator)
+	: m_defaultState(animator.defaultAnimationIndex())
+{
+	for (auto name : defaultPropertyNames)
+		m_propertyNames.push_back(name);
+
+	//the properties read by each state, the names are all known only at the end
+	std::vector<std::vector<size_t>> reads(animator.animationCount());
+
+	for (unsigned int i = 0; i < animator.animationCount(); i++)
+	{
+		State state;
+		state.firstFrame = m_frames.size();
+		state.frameCount = 0;
+		state.duration = 0;
+		state.loop = false;
+		state.xFlipped = animator.isAnimationXFlipped(i);
+		state.yFlipped = animator.isAnimationYFlipped(i);
+		state.alwaysEvaluated = false;
+
+		const auto & animation = animator.animation(i);
+		m_animationVersions.push_back(animation ? animation->version() : 0);
+		if (animation)
+		{
+			m_frames.insert(m_frames.end(), animation->begin(), animation->end());
+			for (const auto & f : *animation)
+				m_spriteFrames.push_back(makeSpriteFrame(f, state.xFlipped, state.yFlipped));
+			m_frameEnds.insert(m_frameEnds.end(), animation->frameEnds().begin(), animation->frameEnds().end());
+			state.frameCount = animation->size();
+			state.duration = animation->duration();
+			state.loop = animation->loop();
+		}
+
+		state.firstTransition = m_transitions.size();
+		for (unsigned int t = 0; t < animator.transitionsCount(); t++)
+		{
+			if (animator.transitionFromStateIndex(t) != i)
+				continue;
+
+			const auto & condition = animator.transitionConditionExpression(t);
+			m_transitions.push_back(Transition{ animator.transitionToStateIndex(t), m_conditionSlots.size() });
+			m_conditions.push_back(condition);
+			for (const auto & name : condition.parameterNames())
+			{
+				auto property = propertyIndex(name);
+				m_conditionSlots.push_back(property);
+				reads[i].push_back(property);
+			}
+			if (!condition.isPure())
+				state.alwaysEvaluated = true;
+		}
+		state.transitionCount = m_transitions.size() - state.firstTransition;
+
+		m_states.push_back(state);
+	}
+
+	m_reads.assign(m_states.size() * m_propertyNames.size(), false);
+	for (size_t i = 0; i < reads.size(); i++)
+		for (auto property : reads[i])
+			m_reads[i * m_propertyNames.size() + property] = true;
+}
+
+bool CompiledAnimator::isOutdated(const Animator & animator) const
+{
+	for (unsigned int i = 0; i < m_animationVersions.size(); i++)
+	{
+		const auto & animation = animator.animation(i);
+		if (animation && animation->version() != m_animationVersions[i])
+			return true;
+	}
+	return false;
+}
+
+namespace
+{
+	unsigned int revision = 0;
+}
+
+unsigned int CompiledAnimator::sourceRevision()
+{
+	return revision;
+}
+
+void CompiledAnimator::sourceChanged()
+{
+	revision++;
+}
+
+bool CompiledAnimator::readsProperty(unsigned int state, size_t property) const
+{
+	assert(state < m_states.size());
+
+	if (property >= m_propertyNames.size())
+		return false;
+	return m_reads[state * m_propertyNames.size() + property] != 0;
+}
+
+size_t CompiledAnimator::frameIndex(const float * frameEnds, size_t frameCount, float time)
+{
+	assert(frameCount > 0);
+
+	auto it = std::lower_bound(frameEnds, frameEnds + frameCount, time);
+	if (it == frameEnds + frameCount)
+		return frameCount - 1;
+	return static_cast<size_t>(it - frameEnds);
+}
+
+size_t CompiledAnimator::propertyIndex(const std::string & name)
+{
+	for (size_t i = 0; i < m_propertyNames.size(); i++)
+		if (m_propertyNames[i] == name)
+			return i;
+	m_propertyNames.push_back(name);
+	return m_propertyNames.size() - 1;
+}
\ No newline at end of file
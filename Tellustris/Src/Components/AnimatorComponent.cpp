@@ -1,38 +1,64 @@
 
 #include "Components/AnimatorComponent.h"
+#include "Systems/AnimatorSystem.h"
+
+#include <algorithm>
+#include <iterator>
 
 Ndk::ComponentIndex AnimatorComponent::componentIndex;
 
 constexpr int defaultPropertyValue = 0;
 
-constexpr auto propertyTimeName = "time";
-constexpr auto propertyTimeSingleName = "timeSingle";
-constexpr auto propertyFinishedName = "finished";
-constexpr auto propertyLoopName = "loops";
-
 AnimatorComponent::AnimatorComponent()
 {
-	addDefaultProperties();
+	bindProperties();
+}
+
+AnimatorComponent::~AnimatorComponent()
+{
+	if (m_slot.system)
+		m_slot.system->removeComponent(*this);
 }
 
 void AnimatorComponent::attachAnimator(AnimatorRef animator)
 {
 	m_animator = animator;
-	if (m_animator)
-		changeState(m_animator->defaultAnimationIndex());
+	m_machine = m_animator ? m_animator->compile() : CompiledAnimatorConstRef();
+	bindProperties();
+
+	if (!m_machine)
+	{
+		updateSystemSlot();
+		return;
+	}
+
+	changeState(m_machine->defaultState());
+	//in a system, the sprites are updated on its next update
+	if (!m_slot.system)
+		updateSprite(0);
 }
 
 void AnimatorComponent::attachSprite(Nz::SpriteRef sprite)
 {
 	assert(sprite);
-	auto it = std::find(m_sprites.begin(), m_sprites.end(), sprite);
-	if (it == m_sprites.end())
-		m_sprites.push_back(sprite);
+	auto it = std::find_if(m_sprites.begin(), m_sprites.end(), [&sprite](const auto & s) { return s.sprite == sprite; });
+	if (it != m_sprites.end())
+		return;
+
+	const auto& material = sprite->GetMaterial();
+	NazaraAssert(material->HasDiffuseMap(), "Sprite material has no diffuse map");
+	auto diffuseMap = material->GetDiffuseMap();
+
+	m_sprites.push_back(AttachedSprite{ sprite, Nz::Vector2f(1.f / diffuseMap->GetWidth(), 1.f / diffuseMap->GetHeight()) });
+
+	//the system only updates the sprites when the frame changes
+	if (m_machine)
+		updateSprite(m_sprites.back(), m_machine->spriteFrame(m_machine->state(m_currentState), currentFrame()));
 }
 
 bool AnimatorComponent::detachSprite(Nz::SpriteRef sprite)
 {
-	auto it = std::find(m_sprites.begin(), m_sprites.end(), sprite);
+	auto it = std::find_if(m_sprites.begin(), m_sprites.end(), [&sprite](const auto & s) { return s.sprite == sprite; });
 	if (it != m_sprites.end())
 	{
 		*it = m_sprites.back();
@@ -49,11 +75,12 @@ void AnimatorComponent::detachAllSprite()
 
 size_t AnimatorComponent::propertyIndex(const std::string & name)
 {
-	for (size_t i = 0; i < m_properties.size(); i++)
-		if (m_properties[i].name == name)
+	for (size_t i = 0; i < m_propertyNames.size(); i++)
+		if (m_propertyNames[i] == name)
 			return i;
-	m_properties.push_back(PropertyValue{ name, defaultPropertyValue });
-	return m_properties.size() - 1;
+	m_propertyNames.push_back(name);
+	m_propertyValues.push_back(defaultPropertyValue);
+	return m_propertyNames.size() - 1;
 }
 
 size_t AnimatorComponent::setProperty(const std::string & name, int value)
@@ -65,21 +92,26 @@ size_t AnimatorComponent::setProperty(const std::string & name, int value)
 
 void AnimatorComponent::setProperty(size_t index, int value)
 {
-	m_properties[index].value = value;
+	if (m_propertyValues[index] == value)
+		return;
+
+	m_propertyValues[index] = value;
+	if (m_machine && m_machine->readsProperty(m_currentState, index))
+		m_conditionsDirty = true;
 }
 
 int AnimatorComponent::property(const std::string & name) const
 {
-	for (const auto & p : m_properties)
-		if (p.name == name)
-			return p.value;
+	for (size_t i = 0; i < m_propertyNames.size(); i++)
+		if (m_propertyNames[i] == name)
+			return m_propertyValues[i];
 	return defaultPropertyValue;
 }
 
 int AnimatorComponent::property(size_t index) const
 {
-	if (index < m_properties.size())
-		return m_properties[index].value;
+	if (index < m_propertyValues.size())
+		return m_propertyValues[index];
 	return defaultPropertyValue;
 }
 
@@ -87,18 +119,19 @@ void AnimatorComponent::resetProperties(bool keepIndexs)
 {
 	if (!keepIndexs)
 	{
-		m_properties.clear();
-		addDefaultProperties();
-		return;
+		m_propertyNames.clear();
+		m_propertyValues.clear();
+		bindProperties();
 	}
-
-	for (auto & p : m_properties)
-		p.value = defaultPropertyValue;
+	else std::fill(m_propertyValues.begin(), m_propertyValues.end(), defaultPropertyValue);
+	m_conditionsDirty = true;
 }
 
 void AnimatorComponent::setSpeed(float speed)
 {
 	m_speed = speed;
+	if (m_slot.system)
+		m_slot.system->m_speeds[m_slot.index] = speed;
 }
 
 float AnimatorComponent::speed() const
@@ -114,10 +147,12 @@ void AnimatorComponent::setCurrentState(const std::string & name)
 
 void AnimatorComponent::setCurrentState(unsigned int index)
 {
-	assert(m_animator);
-	assert(index < m_animator->animationCount());
+	assert(m_machine);
+	assert(index < m_machine->stateCount());
 
 	changeState(index);
+	if (!m_slot.system)
+		updateSprite(0);
 }
 
 unsigned int AnimatorComponent::currentState() const
@@ -136,118 +171,129 @@ AnimatorRef AnimatorComponent::animator() const
 	return m_animator;
 }
 
-void AnimatorComponent::update(float elapsedTime)
+bool AnimatorComponent::updateTransitions(float stateTime, float animationTime)
 {
-	if (!m_animator)
-		return;
-
-	m_animationTime += elapsedTime * m_speed;
-	auto anim = m_animator->animation(m_currentState);
-	assert(anim);
-	if(anim->loop)
-		m_animationTime = fmod(m_animationTime, m_animationDuration);
-	else m_animationTime = std::min(m_animationTime, m_animationDuration);
-	m_stateTime += elapsedTime * m_speed;
+	assert(m_machine);
 
-	updateDefaultProperties();
-	for (auto & t : m_transitionExpressions)
-	{
-		t.expression.resetParameters();
+	updateDefaultProperties(stateTime, animationTime);
 
-		for (const auto & p : m_properties)
-			t.expression.setParameter(p.name, p.value);
+	const auto & state = m_machine->state(m_currentState);
+	if (!m_conditionsDirty && !state.alwaysEvaluated)
+		return false;
+	m_conditionsDirty = false;
 
-		if (t.expression.compute())
+	const auto * slots = m_machine->conditionSlots().data();
+	for (size_t i = state.firstTransition; i < state.firstTransition + state.transitionCount; i++)
+	{
+		const auto & t = m_machine->transition(i);
+		if (m_machine->condition(i).compute(m_propertyValues.data(), slots + t.firstSlot, m_conditionRegisters, m_conditionArguments))
 		{
-			changeState(t.nextStateIndex);
-			return;
+			changeState(t.nextState);
+			return true;
 		}
 	}
-
-	updateSprite();
+	return false;
 }
 
 void AnimatorComponent::changeState(unsigned int nextState)
 {
-	assert(m_animator);
-	assert(nextState < m_animator->animationCount());
+	assert(m_machine);
+	assert(nextState < m_machine->stateCount());
+	assert(m_machine->state(nextState).frameCount > 0);
 
-	m_transitionExpressions.clear();
 	m_currentState = nextState;
 	m_stateTime = 0.f;
 	m_animationTime = 0.f;
+	m_frame = 0;
+	m_conditionsDirty = true;
 
-	auto anim = m_animator->animation(m_currentState);
-	assert(anim);
-	m_animationDuration = anim->duration();
+	updateSystemSlot();
+}
 
-	auto transitionsIndexs = m_animator->outStateTransitionsIndexs(m_currentState);
-	for (auto index : transitionsIndexs)
+void AnimatorComponent::updateMachine()
+{
+	if (!m_animator)
+		return;
+	auto machine = m_animator->compile();
+	if (machine == m_machine)
+		return;
+
+	//the times are kept, they are only up to date in the arrays of the system
+	if (m_slot.system)
+		m_slot.system->store(m_slot.index);
+
+	m_machine = machine;
+	bindProperties();
+
+	if (m_currentState < m_machine->stateCount() && m_machine->state(m_currentState).frameCount > 0)
 	{
-		Transition t;
-		t.expression = m_animator->transitionConditionExpression(index);
-		t.nextStateIndex = m_animator->transitionToStateIndex(index);
-		m_transitionExpressions.push_back(t);
+		m_frame = 0;
+		m_conditionsDirty = true;
+		updateSystemSlot();
 	}
+	else changeState(m_machine->defaultState());
 
-	updateSprite();
+	if (!m_slot.system)
+		updateSprite(0);
 }
 
-void AnimatorComponent::addDefaultProperties()
+void AnimatorComponent::bindProperties()
 {
-	m_propertyTime = propertyIndex(propertyTimeName);
-	m_propertyTimeSingle = propertyIndex(propertyTimeSingleName);
-	m_propertyFinished = propertyIndex(propertyFinishedName);
-	m_propertyLoop = propertyIndex(propertyLoopName);
+	//the properties read by the conditions come first, at the indexs used by the compiled animator
+	auto names = std::move(m_propertyNames);
+	auto values = std::move(m_propertyValues);
+
+	m_propertyNames.clear();
+	if (m_machine)
+		m_propertyNames = m_machine->propertyNames();
+	else m_propertyNames.assign(std::begin(CompiledAnimator::defaultPropertyNames), std::end(CompiledAnimator::defaultPropertyNames));
+	m_propertyValues.assign(m_propertyNames.size(), defaultPropertyValue);
+
+	for (size_t i = 0; i < names.size(); i++)
+		m_propertyValues[propertyIndex(names[i])] = values[i];
 }
 
-void AnimatorComponent::updateDefaultProperties()
+void AnimatorComponent::updateSystemSlot()
 {
-	assert(m_animator);
+	if (m_slot.system)
+		m_slot.system->load(m_slot.index);
+}
 
-	setProperty(m_propertyTime, static_cast<int>(m_stateTime));
-	setProperty(m_propertyTimeSingle, static_cast<int>(m_animationTime));
-	auto anim = m_animator->animation(m_currentState);
-	assert(anim);
-	int loopNb = static_cast<int>(m_stateTime / m_animationDuration);
-	if (!anim->loop)
+void AnimatorComponent::updateDefaultProperties(float stateTime, float animationTime)
+{
+	const auto & state = m_machine->state(m_currentState);
+
+	setProperty(CompiledAnimator::propertyTime, static_cast<int>(stateTime));
+	setProperty(CompiledAnimator::propertyTimeSingle, static_cast<int>(animationTime));
+	int loopNb = static_cast<int>(stateTime / state.duration);
+	if (!state.loop)
 		loopNb = std::min(1, loopNb);
-	setProperty(m_propertyFinished, !anim->loop && loopNb > 0);
-	setProperty(m_propertyLoop, loopNb);
+	setProperty(CompiledAnimator::propertyFinished, !state.loop && loopNb > 0);
+	setProperty(CompiledAnimator::propertyLoop, loopNb);
 }
 
-void AnimatorComponent::updateSprite()
+void AnimatorComponent::updateSprite(size_t frameIndex)
 {
-	assert(m_animator);
-	auto anim = m_animator->animation(m_currentState);
-	assert(anim);
+	assert(m_machine);
 
-	auto frame = anim->current(m_animationTime, false);
+	const auto & frame = m_machine->spriteFrame(m_machine->state(m_currentState), frameIndex);
+	for (const auto & s : m_sprites)
+		updateSprite(s, frame);
+}
 
-	for (auto & s : m_sprites)
-	{
-		//does the same than SetTextureRect to be able to flip uvs
-		const auto& material = s->GetMaterial();
-		NazaraAssert(material->HasDiffuseMap(), "Sprite material has no diffuse map");
-		auto diffuseMap = material->GetDiffuseMap();
-
-		float invWidth = 1.f / diffuseMap->GetWidth();
-		float invHeight = 1.f / diffuseMap->GetHeight();
-		
-		Nz::Rectf rect(invWidth * frame.rect.x, invHeight * frame.rect.y, invWidth * frame.rect.width, invHeight * frame.rect.height);
-		if (m_animator->isAnimationXFlipped(m_currentState))
-		{
-			rect.width *= -1;
-			rect.x -= rect.width;
-		}
-		if (m_animator->isAnimationYFlipped(m_currentState))
-		{
-			rect.height *= -1;
-			rect.y -= rect.height;
-		}
+void AnimatorComponent::updateSprite(const AttachedSprite & sprite, const CompiledAnimator::SpriteFrame & frame) const
+{
+	//does the same than SetTextureRect to be able to flip uvs
+	const auto & rect = frame.textureRect;
+	const auto & inv = sprite.invTextureSize;
+	sprite.sprite->SetTextureCoords(Nz::Rectf(rect.x * inv.x, rect.y * inv.y, rect.width * inv.x, rect.height * inv.y));
+	sprite.sprite->SetSize(frame.size);
+	sprite.sprite->SetOrigin(frame.origin);
+}
 
-		s->SetTextureCoords(rect);
-		s->SetSize(Nz::Vector2f(static_cast<float>(frame.rect.width), static_cast<float>(frame.rect.height)));
-		s->SetOrigin(Nz::Vector3f(static_cast<float>(frame.offset.x), static_cast<float>(frame.offset.y), 0));
-	}
+size_t AnimatorComponent::currentFrame() const
+{
+	if (m_slot.system)
+		return m_slot.system->m_frames[m_slot.index];
+	return m_frame;
 }
\ No newline at end of file
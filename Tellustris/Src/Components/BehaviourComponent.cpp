@@ -1,5 +1,6 @@
 
 #include "Components/BehaviourComponent.h"
+#include "Systems/BehaviourSystem.h"
 
 #include <cassert>
 
@@ -21,38 +22,62 @@ BehaviourComponent & BehaviourComponent::operator=(const BehaviourComponent & co
 
 	assert(m_haveEntity == GetEntity().IsValid());
 
+	if (m_system)
+		for (const auto & b : m_behaviours)
+			m_system->removeBehaviour(*b);
 	m_behaviours.clear();
 
 	for (const auto & b : comp.m_behaviours)
 	{
 		m_behaviours.push_back(std::move(b->clone()));
 		m_behaviours.back()->m_index = m_behaviours.size() - 1;
+		initBehaviour(*m_behaviours.back());
 		if (m_haveEntity)
 		{
 			m_behaviours.back()->m_entity = GetEntity();
 			m_behaviours.back()->onEnable();
 		}
+		if (m_system)
+			m_system->addBehaviour(*this, *m_behaviours.back());
+		setHaveNewBehaviours();
 	}
 
 	return *this;
 }
 
+BehaviourComponent::~BehaviourComponent()
+{
+	if (m_system)
+		m_system->removeComponent(*this);
+}
+
 void BehaviourComponent::update(float elapsedTime)
 {
 	if (!m_haveEntity)
 		return;
 
-	for (auto & b : m_behaviours)
-		if (!b->m_started)
-		{
-			b->onStart();
-			b->m_started = true;
-		}
+	start();
 
 	for (auto & b : m_behaviours)
 		b->onUpdate(elapsedTime);
 }
 
+void BehaviourComponent::start()
+{
+	if (!m_haveEntity || !m_haveNewBehaviours)
+		return;
+	m_haveNewBehaviours = false;
+
+	for (size_t i = 0; i < m_behaviours.size(); i++)
+	{
+		auto & b = m_behaviours[i];
+		if (b->m_started)
+			continue;
+		b->m_started = true;
+		b->onStart();
+	}
+}
+
 void BehaviourComponent::attach(BehaviourRef behaviour)
 {
 	assert(behaviour);
@@ -64,14 +89,20 @@ void BehaviourComponent::attach(BehaviourRef behaviour)
 		behaviour->onEnable();
 	}
 
+	initBehaviour(*behaviour);
 	behaviour->m_index = m_behaviours.size();
 	m_behaviours.push_back(std::move(behaviour));
+	if (m_system)
+		m_system->addBehaviour(*this, *m_behaviours.back());
+	setHaveNewBehaviours();
 }
 
 void BehaviourComponent::detach(size_t index)
 {
 	assert(index < m_behaviours.size());
 
+	if (m_system)
+		m_system->removeBehaviour(*m_behaviours[index]);
 	m_behaviours.erase(m_behaviours.begin() + index);
 	for (size_t i = index; i < m_behaviours.size(); i++)
 		m_behaviours[i]->m_index = i;
@@ -84,6 +115,23 @@ void BehaviourComponent::detachAll()
 			b->onDisable();
 }
 
+void BehaviourComponent::initBehaviour(Behaviour & behaviour)
+{
+	behaviour.m_threading = behaviour.threading();
+	behaviour.m_access.clear();
+	if (behaviour.m_threading == BehaviourThreading::access)
+		behaviour.declareAccess(behaviour.m_access);
+}
+
+void BehaviourComponent::setHaveNewBehaviours()
+{
+	if (m_haveNewBehaviours)
+		return;
+	m_haveNewBehaviours = true;
+	if (m_system)
+		m_system->startLater(*this);
+}
+
 void BehaviourComponent::OnAttached() 
 {
 	assert(!m_haveEntity); 
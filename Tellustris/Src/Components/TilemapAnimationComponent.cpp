@@ -3,6 +3,7 @@
 #include "Utility/Expression/ExpressionParser.h"
 
 #include <algorithm>
+#include <cmath>
 
 
 Ndk::ComponentIndex TilemapAnimationComponent::componentIndex;
@@ -86,60 +87,63 @@ void TilemapAnimationComponent::update(float elapsedTime)
 	if (!m_tilemap)
 		return;
 
+	float previousTime = m_time;
 	m_time += elapsedTime;
 	auto fTime = m_tileAnimations->frameTime();
-	auto tileSize = m_tilemap->tileSize();
-	auto tileDelta = m_tilemap->tileDelta();
 
-	std::vector<Nz::Vector2ui> sizes;
+	m_rendererSizes.clear();
 	for (const auto & r : m_renderers)
 	{
 		const auto& material = r->GetMaterial();
 		NazaraAssert(material->HasDiffuseMap(), "Sprite material has no diffuse map");
 		auto diffuseMap = material->GetDiffuseMap();
 
-		sizes.push_back(Nz::Vector2ui(diffuseMap->GetWidth(), diffuseMap->GetHeight()));
+		m_rendererSizes.push_back(Nz::Vector2ui(diffuseMap->GetWidth(), diffuseMap->GetHeight()));
 	}
 
-	for (auto & a : m_playingAnimations)
-		updateFrame(a, sizes, fTime, tileSize, tileDelta, a.delay);
+	updateWheel(previousTime, fTime);
+
+	for (auto pos : m_refreshedTiles)
+	{
+		auto index = m_animatedTileIndexs[pos];
+		if (index != noTile)
+			updateAnimatedTile(m_animatedTiles[index], fTime);
+	}
+	m_refreshedTiles.clear();
 
 	for (int i = static_cast<int>(m_tempPlayingAnimations.size()) - 1; i >= 0; i--)
 	{
 		auto & a = m_tempPlayingAnimations[i];
 		if (m_time - a.delay > fTime * m_tileAnimations->animation(a.animationIndex).size())
 		{
-			auto it = std::find_if(m_playingAnimations.begin(), m_playingAnimations.end(), [a](const auto & p) {return p.x == a.x && p.y == a.y; });
-			if (it != m_playingAnimations.end())
-				it->overWrite = false;
-
-			removeFrame(m_tempPlayingAnimations[i].x, m_tempPlayingAnimations[i].y);
-			m_tempPlayingAnimations[i] = m_tempPlayingAnimations.back();
-			m_tempPlayingAnimations.pop_back();
-
+			removeFrame(a.x, a.y);
+			removePlayingAnimation(static_cast<unsigned int>(i));
 		}
 	}
 
 	for (auto & a : m_tempPlayingAnimations)
-		updateFrame(a, sizes, fTime, tileSize, tileDelta, a.delay);
+		updateFrame(a, fTime);
 }
 
 void TilemapAnimationComponent::playAnimation(size_t x, size_t y, unsigned int tileID)
 {
-	auto it = std::find_if(m_tempPlayingAnimations.begin(), m_tempPlayingAnimations.end(), [x, y](const auto & p) {return p.x == x && p.y == y; });
-	if (it != m_tempPlayingAnimations.end())
-	{
-		*it = m_tempPlayingAnimations.back();
-		m_tempPlayingAnimations.pop_back();
-	}
+	assert(m_tilemap && x < m_tilemap->width() && y < m_tilemap->height());
+	if (x + y * m_tilemap->width() >= m_playingAnimationIndexs.size())
+		return;
 
-	assert(m_tileAnimations->haveAnimation(tileID));
-	auto animSize = m_tileAnimations->animation(tileID).size();
-	m_tempPlayingAnimations.push_back(PlayingAnimation{ m_tileAnimations->index(tileID), x, y, animSize, m_time, false });
+	auto playing = playingAnimationIndex(x, y);
+	if (playing != noTile)
+		removePlayingAnimation(playing);
 
-	it = std::find_if(m_playingAnimations.begin(), m_playingAnimations.end(), [x, y](const auto & p) {return p.x == x && p.y == y; });
-	if (it != m_playingAnimations.end())
-		it->overWrite = true;
+	auto animationIndex = m_tileAnimations->lookup(tileID);
+	assert(animationIndex != TilemapAnimations::noAnimation);
+	auto animSize = m_tileAnimations->animation(animationIndex).size();
+	m_playingAnimationIndexs[x + y * m_tilemap->width()] = static_cast<unsigned int>(m_tempPlayingAnimations.size());
+	m_tempPlayingAnimations.push_back(PlayingAnimation{ animationIndex, x, y, animSize, m_time });
+
+	auto index = animatedTileIndex(x, y);
+	if (index != noTile)
+		m_animatedTiles[index].overWrite = true;
 }
 
 void TilemapAnimationComponent::onTilemapUpdate(size_t x, size_t y)
@@ -149,25 +153,17 @@ void TilemapAnimationComponent::onTilemapUpdate(size_t x, size_t y)
 	if (!m_tilemap)
 		return;
 
-	if (x > m_tilemap->width() || y > m_tilemap->height())
+	if (x >= m_tilemap->width() || y >= m_tilemap->height() || m_animatedTileIndexs.size() != m_tilemap->width() * m_tilemap->height())
 		updateAnimations();
 	else
 	{
-		auto it = std::find_if(m_playingAnimations.begin(), m_playingAnimations.end(), [x, y](const auto & t) { return x == t.x && y == t.y; });
-		if (it != m_playingAnimations.end())
-		{
-			*it = m_playingAnimations.back();
-			m_playingAnimations.pop_back();
-		}
+		removeAnimatedTile(x, y);
 
-		it = std::find_if(m_tempPlayingAnimations.begin(), m_tempPlayingAnimations.end(), [x, y](const auto & t) {return x == t.x && y == t.y; });
-		if (it != m_tempPlayingAnimations.end())
-		{
-			*it = m_tempPlayingAnimations.back();
-			m_tempPlayingAnimations.pop_back();
-		}
+		auto playing = playingAnimationIndex(x, y);
+		if (playing != noTile)
+			removePlayingAnimation(playing);
 
-		addTile(x, y, m_playingAnimations, m_tilemap->getTile(x, y).id);
+		addTile(x, y, m_tilemap->getTile(x, y).id);
 	}
 }
 
@@ -178,75 +174,225 @@ void TilemapAnimationComponent::onAnimationUpdate()
 
 void TilemapAnimationComponent::updateAnimations()
 {
-	m_playingAnimations.clear();
+	m_animatedTiles.clear();
+	m_animatedTileIndexs.clear();
+	for (auto & bucket : m_wheel)
+		bucket.clear();
+	m_wheel.resize(wheelSize);
+	m_refreshedTiles.clear();
 	m_tempPlayingAnimations.clear();
+	m_playingAnimationIndexs.clear();
 
 	if (!m_tileAnimations)
 		return;
 	if (!m_tilemap)
 		return;
 
-	for(size_t x = 0; x < m_tilemap->width(); x++)
+	m_animatedTileIndexs.assign(m_tilemap->width() * m_tilemap->height(), noTile);
+	m_playingAnimationIndexs.assign(m_tilemap->width() * m_tilemap->height(), noTile);
+	m_refreshAll = true;
+
+	//positions of the tiles grouped by animation, each expression is computed once for all its tiles
+	struct AnimationTiles
+	{
+		std::vector<size_t> xs;
+		std::vector<size_t> ys;
+		std::vector<float> normalizedXs;
+		std::vector<float> normalizedYs;
+		std::vector<float> delays;
+	};
+	std::vector<AnimationTiles> tiles;
+
+	for (size_t x = 0; x < m_tilemap->width(); x++)
 		for (size_t y = 0; y < m_tilemap->height(); y++)
-			addTile(x, y, m_playingAnimations, m_tilemap->getTile(x, y).id);
+		{
+			auto index = m_tileAnimations->lookup(m_tilemap->getTile(x, y).id);
+			if (index == TilemapAnimations::noAnimation)
+				continue;
+			if (index >= tiles.size())
+				tiles.resize(index + 1);
+			auto & t = tiles[index];
+			t.xs.push_back(x);
+			t.ys.push_back(y);
+			t.normalizedXs.push_back(float(x) / m_tilemap->width());
+			t.normalizedYs.push_back(float(y) / m_tilemap->height());
+		}
+
+	for (size_t index = 0; index < tiles.size(); index++)
+	{
+		auto & t = tiles[index];
+		if (t.xs.empty())
+			continue;
+
+		computeDelays(index, t.normalizedXs, t.normalizedYs, t.delays);
+		for (size_t i = 0; i < t.xs.size(); i++)
+			insertAnimatedTile(t.xs[i], t.ys[i], index, t.delays[i]);
+	}
 }
 
-void TilemapAnimationComponent::addTile(size_t x, size_t y, std::vector<TilemapAnimationComponent::PlayingAnimation> & vect, unsigned int tile)
+void TilemapAnimationComponent::addTile(size_t x, size_t y, unsigned int tile)
 {
-	if (!m_tileAnimations->haveAnimation(tile))
+	auto index = m_tileAnimations->lookup(tile);
+	if (index == TilemapAnimations::noAnimation)
 		return;
-	auto expression = m_tileAnimations->animationExpression(tile);
-	expression.resetParameters();
-	expression.setParameter("x", float(x) / m_tilemap->width());
-	expression.setParameter("y", float(y) / m_tilemap->height());
-	auto animSize = m_tileAnimations->animation(tile).size();
-	float time = expression.compute();
-	time *= m_tileAnimations->frameTime() * animSize;
-	vect.push_back(PlayingAnimation{ m_tileAnimations->index(tile), x, y, animSize, expression.compute() , false});
-	expression.resetParameters();
-
-	auto it = std::find_if(m_tempPlayingAnimations.begin(), m_tempPlayingAnimations.end(), [x, y](const auto & p) {return p.x == x && p.y == y; });
-	if (it != m_tempPlayingAnimations.end())
-		vect.back().overWrite = true;
+	std::vector<float> delay;
+	computeDelays(index, { float(x) / m_tilemap->width() }, { float(y) / m_tilemap->height() }, delay);
+	insertAnimatedTile(x, y, index, delay.front());
+
+	if (playingAnimationIndex(x, y) != noTile)
+		m_animatedTiles.back().overWrite = true;
+	else m_refreshedTiles.push_back(static_cast<unsigned int>(x + y * m_tilemap->width()));
 }
 
+void TilemapAnimationComponent::computeDelays(size_t animationIndex, const std::vector<float> & xs, const std::vector<float> & ys, std::vector<float> & delays) const
+{
+	assert(xs.size() == ys.size());
+
+	const auto & expression = m_tileAnimations->animationExpression(animationIndex);
+	const auto & names = expression.parameterNames();
 
-void TilemapAnimationComponent::updateFrame(PlayingAnimation & a, const std::vector<Nz::Vector2ui> & renderersSize, float fTime, unsigned int tileSize, unsigned int tileDelta, float delay)
+	//x and y are the normalized position of the tile, the other parameters are 0
+	std::vector<float> zeros(xs.size(), 0);
+	std::vector<const float *> parameters(names.size(), zeros.data());
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		if (names[i] == "x")
+			parameters[i] = xs.data();
+		else if (names[i] == "y")
+			parameters[i] = ys.data();
+	}
+
+	delays.resize(xs.size());
+	expression.computeBatch(parameters.data(), xs.size(), delays.data());
+}
+
+void TilemapAnimationComponent::insertAnimatedTile(size_t x, size_t y, size_t animationIndex, float delay)
 {
-	if (a.overWrite)
+	//the frames of the tile change when the fractional part of time / frameTime is the one of delay / frameTime
+	float phase = delay / m_tileAnimations->frameTime();
+	phase -= std::floor(phase);
+	auto bucket = std::min(static_cast<unsigned int>(phase * wheelSize), wheelSize - 1);
+
+	auto index = static_cast<unsigned int>(m_animatedTiles.size());
+	m_animatedTiles.push_back(AnimatedTile{ static_cast<unsigned int>(x), static_cast<unsigned int>(y), static_cast<unsigned int>(animationIndex), delay
+		, bucket, static_cast<unsigned int>(m_wheel[bucket].size()), false });
+	m_wheel[bucket].push_back(index);
+	m_animatedTileIndexs[x + y * m_tilemap->width()] = index;
+}
+
+void TilemapAnimationComponent::removeAnimatedTile(size_t x, size_t y)
+{
+	auto index = animatedTileIndex(x, y);
+	if (index == noTile)
 		return;
+	m_animatedTileIndexs[x + y * m_tilemap->width()] = noTile;
 
-	const auto & anim = m_tileAnimations->animation(a.animationIndex);
-	size_t index = static_cast<size_t>((m_time - a.delay) / fTime) % anim.size();
+	const auto & tile = m_animatedTiles[index];
+	auto & bucket = m_wheel[tile.bucket];
+	auto moved = bucket.back();
+	bucket[tile.bucketIndex] = moved;
+	m_animatedTiles[moved].bucketIndex = tile.bucketIndex;
+	bucket.pop_back();
 
-	if (index == a.currentFrameIndex)
-		return;
+	auto last = static_cast<unsigned int>(m_animatedTiles.size() - 1);
+	if (index != last)
+	{
+		auto & t = m_animatedTiles[index];
+		t = m_animatedTiles[last];
+		m_wheel[t.bucket][t.bucketIndex] = index;
+		m_animatedTileIndexs[t.x + t.y * m_tilemap->width()] = index;
+	}
+	m_animatedTiles.pop_back();
+}
 
-	a.currentFrameIndex = index;
+unsigned int TilemapAnimationComponent::animatedTileIndex(size_t x, size_t y) const
+{
+	auto pos = x + y * m_tilemap->width();
+	if (pos >= m_animatedTileIndexs.size())
+		return noTile;
+	return m_animatedTileIndexs[pos];
+}
 
-	for (size_t i = 0; i < m_renderers.size(); i++)
+unsigned int TilemapAnimationComponent::playingAnimationIndex(size_t x, size_t y) const
+{
+	auto pos = x + y * m_tilemap->width();
+	if (pos >= m_playingAnimationIndexs.size())
+		return noTile;
+	return m_playingAnimationIndexs[pos];
+}
+
+void TilemapAnimationComponent::removePlayingAnimation(unsigned int index)
+{
+	assert(index < m_tempPlayingAnimations.size());
+
+	auto width = m_tilemap->width();
+	const auto & a = m_tempPlayingAnimations[index];
+	m_playingAnimationIndexs[a.x + a.y * width] = noTile;
+
+	if (index != m_tempPlayingAnimations.size() - 1)
 	{
-		auto tileSpace = tileSize + tileDelta;
-		auto nbWidth = (renderersSize[i].x + m_tilemap->tileDelta()) / tileSpace;
-		assert(nbWidth > 0);
+		m_tempPlayingAnimations[index] = m_tempPlayingAnimations.back();
+		const auto & moved = m_tempPlayingAnimations[index];
+		m_playingAnimationIndexs[moved.x + moved.y * width] = index;
+	}
+	m_tempPlayingAnimations.pop_back();
+}
 
-		float invWidth = 1.f / renderersSize[i].x;
-		float invHeight = 1.f / renderersSize[i].y;
+void TilemapAnimationComponent::updateWheel(float previousTime, float fTime)
+{
+	//the bucket b is visited when the wheel passes its end, all its tiles have changed of frame
+	auto previous = static_cast<long long>(std::floor(previousTime / fTime * wheelSize));
+	auto current = static_cast<long long>(std::floor(m_time / fTime * wheelSize));
 
-		auto tX = anim[a.currentFrameIndex] % nbWidth;
-		auto tY = anim[a.currentFrameIndex] / nbWidth;
+	if (m_refreshAll || current - previous >= wheelSize)
+	{
+		m_refreshAll = false;
+		for (const auto & t : m_animatedTiles)
+			updateAnimatedTile(t, fTime);
+		return;
+	}
 
-		Nz::Rectf rect(tX * tileSpace * invWidth, tY * tileSpace * invHeight, tileSize * invWidth, tileSize * invHeight);
-		m_renderers[i]->EnableTile(Nz::Vector2ui(static_cast<unsigned int>(a.x), static_cast<unsigned int>(a.y)), rect);
+	for (auto i = previous; i < current; i++)
+	{
+		const auto & bucket = m_wheel[static_cast<size_t>((i % wheelSize + wheelSize) % wheelSize)];
+		for (auto index : bucket)
+			updateAnimatedTile(m_animatedTiles[index], fTime);
 	}
 }
 
+void TilemapAnimationComponent::updateAnimatedTile(const AnimatedTile & tile, float fTime)
+{
+	if (tile.overWrite)
+		return;
+
+	//half a bucket ahead, a tile visited by the wheel has just changed of frame and the rounding must not give the previous one
+	const auto & anim = m_tileAnimations->animation(static_cast<size_t>(tile.animationIndex));
+	auto frame = static_cast<long long>(std::floor((m_time - tile.delay) / fTime + 0.5f / wheelSize)) % static_cast<long long>(anim.size());
+	if (frame < 0)
+		frame += anim.size();
+
+	drawTile(tile.x, tile.y, anim[static_cast<size_t>(frame)]);
+}
+
+void TilemapAnimationComponent::updateFrame(PlayingAnimation & a, float fTime)
+{
+	const auto & anim = m_tileAnimations->animation(a.animationIndex);
+	size_t index = static_cast<size_t>((m_time - a.delay) / fTime) % anim.size();
+
+	if (index == a.currentFrameIndex)
+		return;
+
+	a.currentFrameIndex = index;
+	drawTile(a.x, a.y, anim[a.currentFrameIndex]);
+}
+
 void TilemapAnimationComponent::removeFrame(size_t x, size_t y)
 {
-	auto it = std::find_if(m_playingAnimations.begin(), m_playingAnimations.end(), [x, y](const auto & t) { return x == t.x && y == t.y; });
-	if (it != m_playingAnimations.end())
+	auto index = animatedTileIndex(x, y);
+	if (index != noTile)
 	{
-		it->currentFrameIndex = ~0;
+		m_animatedTiles[index].overWrite = false;
+		updateAnimatedTile(m_animatedTiles[index], m_tileAnimations->frameTime());
 		return;
 	}
 
@@ -262,26 +408,28 @@ void TilemapAnimationComponent::removeFrame(size_t x, size_t y)
 		return;
 	}
 
+	drawTile(x, y, id);
+}
+
+void TilemapAnimationComponent::drawTile(size_t x, size_t y, unsigned int tileID)
+{
+	assert(m_rendererSizes.size() == m_renderers.size());
+
 	auto tileSize = m_tilemap->tileSize();
-	auto tileDelta = m_tilemap->tileDelta();
+	auto tileSpace = tileSize + m_tilemap->tileDelta();
 
-	for (auto & r : m_renderers)
+	for (size_t i = 0; i < m_renderers.size(); i++)
 	{
-		const auto& material = r->GetMaterial();
-		NazaraAssert(material->HasDiffuseMap(), "Sprite material has no diffuse map");
-		auto diffuseMap = material->GetDiffuseMap();
-
-		auto tileSpace = tileSize + tileDelta;
-		auto nbWidth = (diffuseMap->GetWidth() + m_tilemap->tileDelta()) / tileSpace;
+		auto nbWidth = (m_rendererSizes[i].x + m_tilemap->tileDelta()) / tileSpace;
 		assert(nbWidth > 0);
 
-		float invWidth = 1.f / diffuseMap->GetWidth();
-		float invHeight = 1.f / diffuseMap->GetHeight();
+		float invWidth = 1.f / m_rendererSizes[i].x;
+		float invHeight = 1.f / m_rendererSizes[i].y;
 
-		auto tX = id % nbWidth;
-		auto tY = id / nbWidth;
+		auto tX = tileID % nbWidth;
+		auto tY = tileID / nbWidth;
 
 		Nz::Rectf rect(tX * tileSpace * invWidth, tY * tileSpace * invHeight, tileSize * invWidth, tileSize * invHeight);
-		r->EnableTile(Nz::Vector2ui(static_cast<unsigned int>(x), static_cast<unsigned int>(y)), rect);
+		m_renderers[i]->EnableTile(Nz::Vector2ui(static_cast<unsigned int>(x), static_cast<unsigned int>(y)), rect);
 	}
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 
 #include "Components/TilemapColliderComponent.h"
-#include "Utility/Matrix.h"
+#include "Tilemap/ColliderMerger.h"
 
 #include <NDK/World.hpp>
 #include <NDK/Components/NodeComponent.hpp>
@@ -84,64 +84,19 @@ void TilemapColliderComponent::updateLayer(unsigned int index)
 	auto & node = entity->AddComponent<Ndk::NodeComponent>();
 	node.SetParent(thisNode);
 
-	Matrix<bool> mat(m_tilemap->width(), m_tilemap->height(), false);
-
-	std::vector<Nz::Collider2DRef> colliders;
-	float tileSize = static_cast<float>(m_tilemap->tileSize());
-
+	ColliderMerger merger(m_tilemap->width(), m_tilemap->height());
 	for (size_t y = 0; y < m_tilemap->height(); y++)
 		for (size_t x = 0; x < m_tilemap->width(); x++)
 		{
-			if (mat(x, y))
-				continue;
-			auto tile = m_tilemap->getTile(x, y);
-			if (!tile.collider.haveCollision())
-				continue;
-
-			if (!tile.collider.haveFullCollision())
-			{
-				colliders.push_back(tile.collider.toCollider(Nz::Vector2f(x * tileSize, y * tileSize), Nz::Vector2f(tileSize, tileSize)));
-			}
-			else if (tile.collider.collisionLayer == index)
-			{
-				size_t width = 1;
-				for (size_t i = 1; i + x < m_tilemap->width(); i++)
-				{
-					if (mat(x + i, y))
-						break;
-					auto tile2 = m_tilemap->getTile(x + i, y);
-					if (!tile2.collider.haveFullCollision())
-						break;
-					if (tile2.collider.collisionLayer != index)
-						break;
-					width++;
-				}
-				size_t height = 1;
-				for (size_t j = 1; j + y < m_tilemap->height(); j++)
-				{
-					bool allValid = true;
-					for (size_t i = 0; i < width; i++)
-					{
-						auto tile3 = m_tilemap->getTile(x + i, y + j);
-						if (mat(x + i, y + j) || !tile3.collider.haveFullCollision() || tile3.collider.collisionLayer != index)
-						{
-							allValid = false;
-							break;
-						}
-					}
-					if (allValid)
-						height++;
-					else break;
-				}
-
-				for (size_t i = 0; i < width; i++)
-					for (size_t j = 0; j < height; j++)
-						mat(x + i, y + j) = true;
-
-				colliders.push_back(Nz::BoxCollider2D::New(Nz::Rectf(x * tileSize, y * tileSize, width * tileSize, height * tileSize)));
-			}
+			auto collider = m_tilemap->getTile(x, y).collider;
+			if (collider.collisionLayer == index)
+				merger.addTile(x, y, collider);
 		}
 
+	std::vector<Nz::Collider2DRef> colliders;
+	float tileSize = static_cast<float>(m_tilemap->tileSize());
+	merger.merge(colliders, Nz::Vector2f(tileSize, tileSize));
+
 	auto & collision = entity->AddComponent<Ndk::CollisionComponent2D>(Nz::CompoundCollider2D::New(colliders));
 
 	m_layers.push_back(ColliderLayer{ index, entity });
@@ -0,0 +1,44 @@
+#include "GameData/Behaviours/BehaviourAccess.h"
+
+#include <algorithm>
+
+bool BehaviourAccess::conflicts(const BehaviourAccess & other) const
+{
+	return intersects(m_writes, other.m_writes) || intersects(m_writes, other.m_reads) || intersects(m_reads, other.m_writes);
+}
+
+void BehaviourAccess::merge(const BehaviourAccess & other)
+{
+	for (auto i : other.m_reads)
+		add(m_reads, i);
+	for (auto i : other.m_writes)
+		add(m_writes, i);
+}
+
+void BehaviourAccess::clear()
+{
+	m_reads.clear();
+	m_writes.clear();
+}
+
+void BehaviourAccess::add(std::vector<Ndk::ComponentIndex> & indexs, Ndk::ComponentIndex index)
+{
+	auto it = std::lower_bound(indexs.begin(), indexs.end(), index);
+	if (it == indexs.end() || *it != index)
+		indexs.insert(it, index);
+}
+
+bool BehaviourAccess::intersects(const std::vector<Ndk::ComponentIndex> & a, const std::vector<Ndk::ComponentIndex> & b)
+{
+	auto itA = a.begin();
+	auto itB = b.begin();
+	while (itA != a.end() && itB != b.end())
+	{
+		if (*itA == *itB)
+			return true;
+		if (*itA < *itB)
+			itA++;
+		else itB++;
+	}
+	return false;
+}
\ No newline at end of file
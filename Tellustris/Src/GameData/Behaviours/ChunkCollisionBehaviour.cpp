@@ -6,6 +6,8 @@
 #include <NDK/Components/NodeComponent.hpp>
 #include <NDK/Components/CollisionComponent2D.hpp>
 
+#include <algorithm>
+
 ChunkCollisionBehaviour::ChunkCollisionBehaviour(Chunk & chunk)
 	: m_chunk(chunk)
 {
@@ -20,8 +22,12 @@ BehaviourRef ChunkCollisionBehaviour::clone() const
 
 void ChunkCollisionBehaviour::onEnable()
 {
-	m_layerChangedHolder = m_chunk.registerLayerChangedCallback([this](const auto & e) {updateCollisions(); });
-	updateCollisions();
+	m_layerChangedHolder = m_chunk.registerLayerChangedCallback([this](const auto & e) {onLayerChange(e.layer, e.state); });
+	for (size_t i = 0; i < m_chunk.layerCount(); i++)
+		m_mapModified.push_back(m_chunk.getMap(i)->registerTilemapModifiedCallback([this](const auto & e) {onMapChange(e.x, e.y); }));
+
+	rescan();
+	flush();
 }
 
 void ChunkCollisionBehaviour::onDisable()
@@ -31,136 +37,173 @@ void ChunkCollisionBehaviour::onDisable()
 	m_layerChangedHolder.disconnect();
 }
 
-void ChunkCollisionBehaviour::updateCollisions()
+void ChunkCollisionBehaviour::onUpdate(float deltaTime)
 {
-	clearCollisions();
+	if (m_dirty)
+		flush();
+}
+
+void ChunkCollisionBehaviour::onLayerChange(size_t layer, Chunk::LayerChanged::ChangeState state)
+{
+	switch (state)
+	{
+	case Chunk::LayerChanged::ChangeState::added:
+		assert(m_mapModified.size() == layer);
+		m_mapModified.push_back(m_chunk.getMap(layer)->registerTilemapModifiedCallback([this](const auto & e) {onMapChange(e.x, e.y); }));
+		break;
+	case Chunk::LayerChanged::ChangeState::removed:
+		assert(m_mapModified.size() == layer + 1);
+		m_mapModified.pop_back();
+		break;
+	default:
+		return;
+	}
+
+	//the tiles of an added layer are already set, and the queued events of a removed layer are lost
+	rescan();
+}
+
+void ChunkCollisionBehaviour::onMapChange(size_t x, size_t y)
+{
+	if (x >= Chunk::chunkSize || y >= Chunk::chunkSize)
+		rescan();
+	else updateTile(x, y);
+}
+
+void ChunkCollisionBehaviour::rescan()
+{
+	for (auto & l : m_layers)
+	{
+		l.merger.clear();
+		l.dirtyBands = (1u << bandCount) - 1;
+	}
+
+	for (size_t y = 0; y < Chunk::chunkSize; y++)
+		for (size_t x = 0; x < Chunk::chunkSize; x++)
+			addTile(x, y);
+
+	m_dirty = true;
+}
+
+void ChunkCollisionBehaviour::updateTile(size_t x, size_t y)
+{
+	unsigned int band = 1u << (y / bandSize);
+
+	for (auto & l : m_layers)
+	{
+		if (l.merger.haveTile(x, y))
+			l.dirtyBands |= band;
+		l.merger.removeTile(x, y);
+	}
+
+	addTile(x, y);
+
+	m_dirty = true;
+}
 
-	std::vector<unsigned int> createdLayers;
+void ChunkCollisionBehaviour::addTile(size_t x, size_t y)
+{
+	unsigned int band = 1u << (y / bandSize);
 
 	for (size_t i = 0; i < m_chunk.layerCount(); i++)
 	{
-		auto layer = m_chunk.getMap(i);
-
-		if (m_mapModified.size() <= i)
-			m_mapModified.push_back(layer->registerTilemapModifiedCallback([this](const auto & e) {updateCollisions(); }));
-
-		for(size_t x = 0 ; x < Chunk::chunkSize ; x++)
-			for (size_t y = 0; y < Chunk::chunkSize; y++)
-			{
-				auto collider = layer->getTile(x, y).collider;
-				if (!collider.haveCollision())
-					continue;
-
-				if (std::find(createdLayers.begin(), createdLayers.end(), collider.collisionLayer) == createdLayers.end())
-				{
-					createdLayers.push_back(collider.collisionLayer);
-					createCollisionLayer(collider.collisionLayer);
-				}
-			}
+		auto collider = m_chunk.getTile(x, y, i).collider;
+		if (!collider.haveCollision())
+			continue;
+
+		auto & l = collisionLayer(collider.collisionLayer);
+		l.merger.addTile(x, y, collider);
+		l.dirtyBands |= band;
 	}
+}
 
+void ChunkCollisionBehaviour::flush()
+{
 	for (size_t i = 0; i < m_layers.size(); i++)
 	{
-		const auto & l = m_layers[i];
-		if (std::find(createdLayers.begin(), createdLayers.end(), l.id) == createdLayers.end())
+		auto & l = m_layers[i];
+		if (l.dirtyBands == 0)
+			continue;
+
+		for (size_t band = 0; band < bandCount; band++)
+			if (l.dirtyBands & (1u << band))
+				rebuildBand(l, band);
+		l.dirtyBands = 0;
+
+		updateGeom(l);
+		if (!l.entity.IsValid())
 		{
-			l.entity->Kill();
 			m_layers[i] = std::move(m_layers.back());
 			m_layers.pop_back();
 			i--;
 		}
 	}
+
+	m_dirty = false;
 }
 
-void ChunkCollisionBehaviour::clearCollisions()
+void ChunkCollisionBehaviour::rebuildBand(ColliderLayer & layer, size_t band)
 {
-	for (auto & layer : m_layers)
-		layer.entity->Kill();
-	m_layers.clear();
+	auto & colliders = layer.bands[band];
+	colliders.clear();
+	layer.merger.merge(colliders, Nz::Vector2f(1, 1), band * bandSize, (band + 1) * bandSize);
 }
 
-void ChunkCollisionBehaviour::createCollisionLayer(unsigned int collisionLayer)
+void ChunkCollisionBehaviour::updateGeom(ColliderLayer & layer)
 {
-	Ndk::EntityHandle entity;
-	auto it = std::find_if(m_layers.begin(), m_layers.end(), [collisionLayer](const auto & l) {return l.id == collisionLayer; });
-	if (it != m_layers.end())
-		entity = it->entity;
-	else
+	m_colliders.clear();
+	for (const auto & b : layer.bands)
+		m_colliders.insert(m_colliders.end(), b.begin(), b.end());
+
+	if (m_colliders.empty())
 	{
-		entity = createEntity();
-		m_layers.push_back(ColliderLayer{ collisionLayer, entity});
+		if (layer.entity.IsValid())
+			layer.entity->Kill();
+		layer.entity = Ndk::EntityHandle();
+		return;
 	}
 
-	Matrix<bool> mat(Chunk::chunkSize, Chunk::chunkSize, false);
-
-	std::vector<Nz::Collider2DRef> colliders;
-
-	for (size_t x = 0; x < Chunk::chunkSize; x++)
-		for (size_t y = 0; y < Chunk::chunkSize; y++)
-		{
-			if (!haveFullCollision(x, y, collisionLayer))
-			{
-				for (size_t i = 0; i < m_chunk.layerCount(); i++)
-				{
-					auto collider = m_chunk.getTile(x, y, i).collider;
-					if (!collider.haveCollision() || collider.collisionLayer != collisionLayer)
-						continue;
-					
-					colliders.push_back(collider.toCollider(Nz::Vector2f(static_cast<float>(x), static_cast<float>(y)), Nz::Vector2f(1, 1)));
-				}
-			}
-			else
-			{
-				size_t width = 1;
-				for (size_t i = 1; i + x < Chunk::chunkSize; i++)
-				{
-					if (mat(x + i, y))
-						break;
-					if (!haveFullCollision(x + i, y, collisionLayer))
-						break;
-					width++;
-				}
-				size_t height = 1;
-				for (size_t j = 1; j + y < Chunk::chunkSize; j++)
-				{
-					bool allValid = true;
-					for (size_t i = 0; i < width; i++)
-					{
-						bool haveCollision = haveFullCollision(x + i, y + j, collisionLayer);
-						if (mat(x + i, y + j) || !haveCollision )
-						{
-							allValid = false;
-							break;
-						}
-					}
-					if (allValid)
-						height++;
-					else break;
-				}
-
-				for (size_t i = 0; i < width; i++)
-					for (size_t j = 0; j < height; j++)
-						mat(x + i, y + j) = true;
-
-				colliders.push_back(Nz::BoxCollider2D::New(Nz::Rectf(static_cast<float>(x), static_cast<float>(y), static_cast<float>(width), static_cast<float>(height))));
-			}
-		}
+	if (!layer.entity.IsValid())
+		layer.entity = createEntity();
 
-	auto & collision = entity->GetComponent<Ndk::CollisionComponent2D>();
-	auto collider = Nz::CompoundCollider2D::New(colliders);
+	auto & collision = layer.entity->GetComponent<Ndk::CollisionComponent2D>();
+	auto collider = Nz::CompoundCollider2D::New(m_colliders);
 
 	auto def = Settings<CollisionDefinition>::value();
-	if (def->haveLayer(collisionLayer))
+	if (def->haveLayer(layer.id))
 	{
-		collider->SetCategoryMask(1 << collisionLayer);
-		collider->SetCollisionMask(def->collisionAndTriggerMask(collisionLayer));
+		collider->SetCategoryMask(1 << layer.id);
+		collider->SetCollisionMask(def->collisionAndTriggerMask(layer.id));
 		collider->SetCollisionGroup(0);
-		collider->SetCollisionId(collisionLayer);
+		collider->SetCollisionId(layer.id);
 	}
 
 	collision.SetGeom(collider);
 }
 
+void ChunkCollisionBehaviour::clearCollisions()
+{
+	for (auto & layer : m_layers)
+		if (layer.entity.IsValid())
+			layer.entity->Kill();
+	m_layers.clear();
+	m_dirty = false;
+}
+
+ChunkCollisionBehaviour::ColliderLayer & ChunkCollisionBehaviour::collisionLayer(unsigned int id)
+{
+	auto it = std::find_if(m_layers.begin(), m_layers.end(), [id](const auto & l) {return l.id == id; });
+	if (it != m_layers.end())
+		return *it;
+
+	m_layers.emplace_back();
+	auto & layer = m_layers.back();
+	layer.id = id;
+	layer.merger.resize(Chunk::chunkSize, Chunk::chunkSize);
+	layer.dirtyBands = 0;
+	return layer;
+}
+
 Ndk::EntityHandle ChunkCollisionBehaviour::createEntity()
 {
 	auto entity = getEntity()->GetWorld()->CreateEntity();
@@ -171,16 +214,4 @@ Ndk::EntityHandle ChunkCollisionBehaviour::createEntity()
 	entity->AddComponent<Ndk::CollisionComponent2D>();
 
 	return entity;
-}
-
-
-bool ChunkCollisionBehaviour::haveFullCollision(size_t x, size_t y, unsigned int collisionLayer) const
-{
-	for (size_t i = 0; i < m_chunk.layerCount(); i++)
-	{
-		auto collider = m_chunk.getTile(x, y, i).collider;
-		if (collider.collisionLayer == collisionLayer && collider.haveFullCollision())
-			return true;
-	}
-	return false;
 }
\ No newline at end of file
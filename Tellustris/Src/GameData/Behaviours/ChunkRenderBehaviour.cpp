@@ -87,7 +87,7 @@ void ChunkRenderBehaviour::onMapChange(size_t layer, size_t x, size_t y)
 
 	if (x >= map->width() || y >= map->height())
 		onFullMapChange(layer);
-	else onTileChange(layer, x, y);
+	else onTileChange(x, y, layer);
 }
 
 void ChunkRenderBehaviour::onLayerAdd(size_t layer)
@@ -121,7 +121,7 @@ void ChunkRenderBehaviour::onLayerAdd(size_t layer)
 	graph.Attach(tilemap, Nz::Matrix4f::Translate(Nz::Vector3f(0, 0, layer - 2.0f)));
 	m_tilemaps.push_back(TilemapInfos{ tilemap, std::move(texturesIndexs) });
 
-	m_mapModified.push_back(m_chunk.getMap(layer)->registerTilemapModifiedCallback([this, layer](const auto & e) {onTileChange(e.x, e.y, layer); }));
+	m_mapModified.push_back(m_chunk.getMap(layer)->registerTilemapModifiedCallback([this, layer](const auto & e) {onMapChange(layer, e.x, e.y); }));
 
 	onFullMapChange(layer);
 }
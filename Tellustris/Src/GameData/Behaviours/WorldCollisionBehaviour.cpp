@@ -0,0 +1,391 @@
+#include "GameData/Behaviours/WorldCollisionBehaviour.h"
+#include "GameData/CollisionDefinition.h"
+#include "Utility/Settings.h"
+
+#include <NDK/World.hpp>
+#include <NDK/Components/NodeComponent.hpp>
+#include <NDK/Components/CollisionComponent2D.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	//only the full bit of the temporary mergers is read
+	const TileCollider fullCollider(static_cast<unsigned int>(TileColliderType::Full) << 4);
+}
+
+WorldCollisionBehaviour::WorldCollisionBehaviour(WorldMap & map, float viewSize)
+	: m_map(map)
+	, m_viewSize(viewSize)
+{
+	m_centerViewUpdateHolder = StaticEvent<CenterViewUpdate>::connect([this](const auto & e) {onCenterViewUpdate(e.x, e.y); });
+}
+
+BehaviourRef WorldCollisionBehaviour::clone() const
+{
+	auto collision = std::make_unique<WorldCollisionBehaviour>(m_map, m_viewSize);
+	return std::move(collision);
+}
+
+void WorldCollisionBehaviour::onEnable()
+{
+	for (auto & c : m_chunks)
+		for (auto & l : c->layers)
+			if (l.entity.IsValid())
+				l.entity->Enable();
+}
+
+void WorldCollisionBehaviour::onDisable()
+{
+	for (auto & c : m_chunks)
+		for (auto & l : c->layers)
+			if (l.entity.IsValid())
+				l.entity->Disable();
+}
+
+void WorldCollisionBehaviour::onUpdate(float deltaTime)
+{
+	if (m_dirty)
+		flush();
+}
+
+void WorldCollisionBehaviour::onCenterViewUpdate(float x, float y)
+{
+	auto viewChunks = getViewChunks(x, y);
+	assert(!viewChunks.empty());
+
+	m_map.generateChunks(viewChunks);
+
+	for (const auto & c : viewChunks)
+		if (chunkInfo(c.x, c.y) == nullptr)
+			addChunk(c.x, c.y);
+
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		const auto & chunk = *m_chunks[i];
+
+		auto it = std::find_if(viewChunks.begin(), viewChunks.end(), [&chunk](const auto & c) {return c.x == chunk.x && c.y == chunk.y; });
+		if (it == viewChunks.end())
+		{
+			removeChunk(i);
+			i--;
+		}
+	}
+}
+
+void WorldCollisionBehaviour::onLayerChange(ChunkInfo & info, size_t layer, Chunk::LayerChanged::ChangeState state)
+{
+	switch (state)
+	{
+	case Chunk::LayerChanged::ChangeState::added:
+		assert(info.mapModified.size() == layer);
+		info.mapModified.push_back(info.chunk.getMap(layer)->registerTilemapModifiedCallback([this, &info](const auto & e) {onMapChange(info, e.x, e.y); }));
+		break;
+	case Chunk::LayerChanged::ChangeState::removed:
+		assert(info.mapModified.size() == layer + 1);
+		info.mapModified.pop_back();
+		break;
+	default:
+		return;
+	}
+
+	//a removed layer is still in the chunk while its event is sent
+	info.needRescan = true;
+	m_dirty = true;
+}
+
+void WorldCollisionBehaviour::onMapChange(ChunkInfo & info, size_t x, size_t y)
+{
+	if (x >= Chunk::chunkSize || y >= Chunk::chunkSize)
+		rescan(info);
+	else updateTile(info, x, y);
+}
+
+void WorldCollisionBehaviour::addChunk(int x, int y)
+{
+	auto info = std::unique_ptr<ChunkInfo>(new ChunkInfo{ m_map.getChunk(x, y), x, y, {}, false });
+	auto & i = *info;
+
+	i.layerChangedHolder = i.chunk.registerLayerChangedCallback([this, &i](const auto & e) {onLayerChange(i, e.layer, e.state); });
+	for (size_t layer = 0; layer < i.chunk.layerCount(); layer++)
+		i.mapModified.push_back(i.chunk.getMap(layer)->registerTilemapModifiedCallback([this, &i](const auto & e) {onMapChange(i, e.x, e.y); }));
+
+	m_chunks.push_back(std::move(info));
+	rescan(i);
+}
+
+void WorldCollisionBehaviour::removeChunk(size_t index)
+{
+	auto & c = *m_chunks[index];
+	for (auto & l : c.layers)
+		if (l.entity.IsValid())
+			l.entity->Kill();
+
+	//the shapes that cross the chunk are cut on the next flush
+	m_unloadedRects.push_back(chunkRect(c.x, c.y));
+	m_chunks.erase(m_chunks.begin() + index);
+	m_dirty = true;
+}
+
+void WorldCollisionBehaviour::rescan(ChunkInfo & info)
+{
+	for (auto & l : info.layers)
+	{
+		l.tiles.clear();
+		l.geomDirty = true;
+	}
+
+	for (size_t y = 0; y < Chunk::chunkSize; y++)
+		for (size_t x = 0; x < Chunk::chunkSize; x++)
+			addTile(info, x, y);
+
+	m_dirtyRects.push_back(chunkRect(info.x, info.y));
+	m_dirty = true;
+}
+
+void WorldCollisionBehaviour::updateTile(ChunkInfo & info, size_t x, size_t y)
+{
+	for (auto & l : info.layers)
+	{
+		//the full tiles are in the shapes, rebuilt from the dirty rects
+		if (l.tiles.haveTile(x, y) && !l.tiles.haveFullTile(x, y))
+			l.geomDirty = true;
+		l.tiles.removeTile(x, y);
+	}
+
+	addTile(info, x, y);
+
+	auto origin = chunkRect(info.x, info.y);
+	m_dirtyRects.emplace_back(origin.x + static_cast<int>(x), origin.y + static_cast<int>(y), 1, 1);
+	m_dirty = true;
+}
+
+void WorldCollisionBehaviour::addTile(ChunkInfo & info, size_t x, size_t y)
+{
+	for (size_t i = 0; i < info.chunk.layerCount(); i++)
+	{
+		auto collider = info.chunk.getTile(x, y, i).collider;
+		if (!collider.haveCollision())
+			continue;
+
+		auto & l = createChunkLayer(info, collider.collisionLayer);
+		l.tiles.addTile(x, y, collider);
+		if (!collider.haveFullCollision())
+			l.geomDirty = true;
+	}
+}
+
+void WorldCollisionBehaviour::flush()
+{
+	for (auto & c : m_chunks)
+	{
+		if (c->needRescan)
+			rescan(*c);
+		c->needRescan = false;
+	}
+
+	for (auto & l : m_layers)
+		rebuildShapes(l);
+
+	for (auto & c : m_chunks)
+		for (auto & l : c->layers)
+			if (l.geomDirty)
+				updateGeom(*c, l);
+
+	m_dirtyRects.clear();
+	m_unloadedRects.clear();
+	m_dirty = false;
+}
+
+void WorldCollisionBehaviour::rebuildShapes(CollisionLayer & layer)
+{
+	//the shapes next to a modified tile are rebuilt too, they can merge with it
+	m_removedShapes.clear();
+	for (size_t i = 0; i < layer.shapes.size(); i++)
+	{
+		const auto & s = layer.shapes[i];
+		Nz::Recti grown(s.rect.x - 1, s.rect.y - 1, s.rect.width + 2, s.rect.height + 2);
+
+		bool touched = std::any_of(m_dirtyRects.begin(), m_dirtyRects.end(), [&grown](const auto & r) { return grown.Intersect(r); })
+			|| std::any_of(m_unloadedRects.begin(), m_unloadedRects.end(), [&s](const auto & r) { return s.rect.Intersect(r); });
+		if (!touched)
+			continue;
+
+		auto owner = chunkInfo(s.owner.x, s.owner.y);
+		if (owner != nullptr)
+		{
+			auto ownerLayer = chunkLayer(*owner, layer.id);
+			assert(ownerLayer != nullptr);
+			ownerLayer->geomDirty = true;
+		}
+
+		m_removedShapes.push_back(s);
+		layer.shapes[i] = layer.shapes.back();
+		layer.shapes.pop_back();
+		i--;
+	}
+
+	//the tiles of the removed shapes and the modified tiles are the only ones without shape
+	m_rects.clear();
+	for (const auto & s : m_removedShapes)
+		m_rects.push_back(s.rect);
+	m_rects.insert(m_rects.end(), m_dirtyRects.begin(), m_dirtyRects.end());
+	if (m_rects.empty())
+		return;
+
+	Nz::Recti box = m_rects.front();
+	for (const auto & r : m_rects)
+		box.ExtendTo(r);
+
+	ColliderMerger merger(box.width, box.height);
+	for (const auto & r : m_rects)
+		addFreeTiles(merger, box, r, layer.id);
+
+	m_rects.clear();
+	merger.fullRects(m_rects);
+	for (auto r : m_rects)
+	{
+		r.x += box.x;
+		r.y += box.y;
+		auto owner = m_map.posToWorldChunkPos(r.x, r.y);
+		layer.shapes.push_back(Shape{ r, owner });
+
+		auto ownerInfo = chunkInfo(owner.x, owner.y);
+		assert(ownerInfo != nullptr);
+		auto ownerLayer = chunkLayer(*ownerInfo, layer.id);
+		assert(ownerLayer != nullptr);
+		ownerLayer->geomDirty = true;
+	}
+}
+
+void WorldCollisionBehaviour::addFreeTiles(ColliderMerger & merger, const Nz::Recti & box, const Nz::Recti & rect, unsigned int id)
+{
+	for (auto & c : m_chunks)
+	{
+		auto origin = chunkRect(c->x, c->y);
+		Nz::Recti tiles;
+		if (!origin.Intersect(rect, &tiles))
+			continue;
+
+		auto l = chunkLayer(*c, id);
+		if (l == nullptr)
+			continue;
+
+		for (int y = tiles.y; y < tiles.y + tiles.height; y++)
+			for (int x = tiles.x; x < tiles.x + tiles.width; x++)
+				if (l->tiles.haveFullTile(x - origin.x, y - origin.y))
+					merger.addTile(x - box.x, y - box.y, fullCollider);
+	}
+}
+
+void WorldCollisionBehaviour::updateGeom(ChunkInfo & info, ChunkLayer & layer)
+{
+	layer.geomDirty = false;
+
+	auto origin = chunkRect(info.x, info.y);
+
+	m_colliders.clear();
+	for (const auto & s : collisionLayer(layer.id).shapes)
+	{
+		if (s.owner.x != info.x || s.owner.y != info.y)
+			continue;
+		Nz::Rectf rect(static_cast<float>(s.rect.x - origin.x), static_cast<float>(s.rect.y - origin.y), static_cast<float>(s.rect.width), static_cast<float>(s.rect.height));
+		m_colliders.push_back(Nz::BoxCollider2D::New(rect));
+	}
+	layer.tiles.mergePartials(m_colliders, Nz::Vector2f(1, 1));
+
+	if (m_colliders.empty())
+	{
+		if (layer.entity.IsValid())
+			layer.entity->Kill();
+		layer.entity = Ndk::EntityHandle();
+		return;
+	}
+
+	if (!layer.entity.IsValid())
+		layer.entity = createEntity(info.x, info.y);
+
+	auto & collision = layer.entity->GetComponent<Ndk::CollisionComponent2D>();
+	auto collider = Nz::CompoundCollider2D::New(m_colliders);
+
+	auto def = Settings<CollisionDefinition>::value();
+	if (def->haveLayer(layer.id))
+	{
+		collider->SetCategoryMask(1 << layer.id);
+		collider->SetCollisionMask(def->collisionAndTriggerMask(layer.id));
+		collider->SetCollisionGroup(0);
+		collider->SetCollisionId(layer.id);
+	}
+
+	collision.SetGeom(collider);
+}
+
+WorldCollisionBehaviour::ChunkInfo * WorldCollisionBehaviour::chunkInfo(int x, int y)
+{
+	auto it = std::find_if(m_chunks.begin(), m_chunks.end(), [x, y](const auto & c) {return c->x == x && c->y == y; });
+	if (it == m_chunks.end())
+		return nullptr;
+	return it->get();
+}
+
+WorldCollisionBehaviour::ChunkLayer * WorldCollisionBehaviour::chunkLayer(ChunkInfo & info, unsigned int id)
+{
+	auto it = std::find_if(info.layers.begin(), info.layers.end(), [id](const auto & l) {return l.id == id; });
+	if (it == info.layers.end())
+		return nullptr;
+	return &*it;
+}
+
+WorldCollisionBehaviour::ChunkLayer & WorldCollisionBehaviour::createChunkLayer(ChunkInfo & info, unsigned int id)
+{
+	auto layer = chunkLayer(info, id);
+	if (layer != nullptr)
+		return *layer;
+
+	collisionLayer(id);
+
+	info.layers.push_back(ChunkLayer{ id, Ndk::EntityHandle(), ColliderMerger(Chunk::chunkSize, Chunk::chunkSize), true });
+	return info.layers.back();
+}
+
+WorldCollisionBehaviour::CollisionLayer & WorldCollisionBehaviour::collisionLayer(unsigned int id)
+{
+	auto it = std::find_if(m_layers.begin(), m_layers.end(), [id](const auto & l) {return l.id == id; });
+	if (it != m_layers.end())
+		return *it;
+
+	m_layers.push_back(CollisionLayer{ id, {} });
+	return m_layers.back();
+}
+
+Ndk::EntityHandle WorldCollisionBehaviour::createEntity(int chunkX, int chunkY)
+{
+	auto entity = getEntity()->GetWorld()->CreateEntity();
+
+	auto & node = entity->AddComponent<Ndk::NodeComponent>();
+	node.SetParent(getEntity()->GetComponent<Ndk::NodeComponent>());
+	node.SetPosition(static_cast<float>(chunkX) * Chunk::chunkSize, static_cast<float>(chunkY) * Chunk::chunkSize, 0);
+	entity->AddComponent<Ndk::CollisionComponent2D>();
+
+	return entity;
+}
+
+std::vector<Nz::Vector2i> WorldCollisionBehaviour::getViewChunks(float x, float y) const
+{
+	auto min = m_map.posToWorldChunkPos(x - m_viewSize, y - m_viewSize);
+	auto max = m_map.posToWorldChunkPos(x + m_viewSize, y + m_viewSize);
+
+	std::vector<Nz::Vector2i> chunks;
+	for (int i = min.x; i <= max.x; i++)
+		for (int j = min.y; j <= max.y; j++)
+			chunks.push_back({ i, j });
+
+	return chunks;
+}
+
+Nz::Recti WorldCollisionBehaviour::chunkRect(int chunkX, int chunkY)
+{
+	int size = static_cast<int>(Chunk::chunkSize);
+	return Nz::Recti(chunkX * size, chunkY * size, size, size);
+}
\ No newline at end of file
@@ -42,8 +42,18 @@ void WorldRenderBehaviour::ChunkBorder::onLayerChange(size_t layer, Chunk::Layer
 
 void WorldRenderBehaviour::ChunkBorder::onMapChange(size_t layer, size_t x, size_t y)
 {
-	if (x >= Chunk::chunkSize || y > Chunk::chunkSize)
+	if (x >= Chunk::chunkSize || y >= Chunk::chunkSize)
+	{
+		//the whole map changed, so did all the border tiles
+		for (size_t i = 0; i < Chunk::chunkSize; i++)
+		{
+			onMapChange(layer, i, 0);
+			onMapChange(layer, i, Chunk::chunkSize - 1);
+			onMapChange(layer, 0, i);
+			onMapChange(layer, Chunk::chunkSize - 1, i);
+		}
 		return;
+	}
 	if (x > 0 && y > 0 && x < Chunk::chunkSize - 1 && y < Chunk::chunkSize - 1)
 		return;
 	//only update borders
@@ -57,8 +67,8 @@ void WorldRenderBehaviour::ChunkBorder::onMapChange(size_t layer, size_t x, size
 			int chunkX = m_chunkX - (i < 0) + (i >= Chunk::chunkSize);
 			int chunkY = m_chunkY - (j < 0) + (j >= Chunk::chunkSize);
 
-			size_t newX = i < 0 ? Chunk::chunkSize - 1 : i > Chunk::chunkSize ? 0 : i;
-			size_t newY = j < 0 ? Chunk::chunkSize - 1 : j > Chunk::chunkSize ? 0 : j;
+			size_t newX = i < 0 ? Chunk::chunkSize - 1 : i >= Chunk::chunkSize ? 0 : i;
+			size_t newY = j < 0 ? Chunk::chunkSize - 1 : j >= Chunk::chunkSize ? 0 : j;
 			assert(!(chunkX == m_chunkX && chunkY == m_chunkY));
 			m_worldRender.onBoderBlockUpdate(chunkX, chunkY, newX, newY, layer);
 		}
@@ -84,6 +94,7 @@ WorldRenderBehaviour::WorldRenderBehaviour(WorldMap & map, TileDefinitionRef def
 	, m_viewSize(viewSize)
 {
 	m_CenterViewUpdateHolder = StaticEvent<CenterViewUpdate>::connect([this](const auto & e) {onCenterViewUpdate(e.x, e.y); });
+	m_chunksGeneratedHolder = m_map.registerChunksGeneratedCallback([this](const auto & e) {onChunksGenerated(e.chunks); });
 }
 
 BehaviourRef WorldRenderBehaviour::clone() const
@@ -124,6 +135,9 @@ void WorldRenderBehaviour::onCenterViewUpdate(float x, float y)
 	auto viewChunks = getViewChunks(x, y);
 	assert(!viewChunks.empty());
 
+	//generate all the missing chunks in one batch before the renderers ask them one by one
+	m_map.generateChunks(viewChunks);
+
 	for (const auto & c : viewChunks)
 	{
 		auto it = std::find_if(m_chunks.begin(), m_chunks.end(), [c](const auto & chunk) {return c.x == chunk.x && c.y == chunk.y; });
@@ -144,6 +158,39 @@ void WorldRenderBehaviour::onCenterViewUpdate(float x, float y)
 	}
 }
 
+void WorldRenderBehaviour::onChunksGenerated(const std::vector<Nz::Vector2ui> & chunks)
+{
+	//the loaded chunks were drawn against the empty neighbours
+	for (const auto & c : m_chunks)
+		for (int dx = -1; dx <= 1; dx++)
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				if (dx == 0 && dy == 0)
+					continue;
+
+				auto pos = m_map.worldToLocalChunkPos(c.x + dx, c.y + dy);
+				if (std::find(chunks.begin(), chunks.end(), pos) != chunks.end())
+					updateBorder(c, dx, dy);
+			}
+}
+
+void WorldRenderBehaviour::updateBorder(const ChunkInfo & chunk, int dx, int dy)
+{
+	size_t minX = dx > 0 ? Chunk::chunkSize - 1 : 0;
+	size_t maxX = dx < 0 ? 0 : Chunk::chunkSize - 1;
+	size_t minY = dy > 0 ? Chunk::chunkSize - 1 : 0;
+	size_t maxY = dy < 0 ? 0 : Chunk::chunkSize - 1;
+
+	size_t layerCount = m_map.getChunk(chunk.x, chunk.y).layerCount();
+	for (size_t layer = 0; layer < layerCount; layer++)
+		for (size_t x = minX; x <= maxX; x++)
+			for (size_t y = minY; y <= maxY; y++)
+			{
+				chunk.behaviour->onBoderBlockUpdate(x, y, layer);
+				chunk.groundBehaviour->onBoderBlockUpdate(x, y, layer);
+			}
+}
+
 void WorldRenderBehaviour::addChunk(int x, int y)
 {
 	//draw layers that are not ground
@@ -34,7 +34,7 @@ void Chunk::setTile(size_t x, size_t y, Tile tile, size_t layer)
 			return;
 		for (size_t i = m_tilemaps.size(); i <= layer; i++)
 		{
-			m_tilemaps.push_back(TilemapLayer{ Tilemap::New(chunkSize, chunkSize, tileSize, tileDelta), static_cast<float>(i) - 1 });
+			m_tilemaps.push_back(TilemapLayer{ createTilemap(), static_cast<float>(i) - 1 });
 			m_event.send(LayerChanged{ i, LayerChanged::ChangeState::added });
 		}
 	}
@@ -62,6 +62,48 @@ void Chunk::setTile(size_t x, size_t y, Tile tile, size_t layer)
 	}
 }
 
+void Chunk::setLayer(size_t layer, const Matrix<Tile> & tiles)
+{
+	assert(tiles.width() == chunkSize);
+	assert(tiles.height() == chunkSize);
+
+	unsigned int count = 0;
+	for (const auto & t : tiles)
+		if (!tilesEqual(t, {}))
+			count++;
+
+	if (layer >= m_tilemaps.size())
+	{
+		if (count == 0)
+			return;
+		for (size_t i = m_tilemaps.size(); i < layer; i++)
+		{
+			m_tilemaps.push_back(TilemapLayer{ createTilemap(), static_cast<float>(i) - 1 });
+			m_event.send(LayerChanged{ i, LayerChanged::ChangeState::added });
+		}
+
+		//the tiles are set before the layer is announced, the listeners draw it only once
+		auto tilemap = Tilemap::New(chunkSize, chunkSize, tileSize, tileDelta);
+		tilemap->setTiles(tiles);
+		tilemap->setQueuedEvents(true);
+		m_tilemaps.push_back(TilemapLayer{ tilemap, static_cast<float>(layer) - 1, count });
+		m_event.send(LayerChanged{ layer, LayerChanged::ChangeState::added });
+		return;
+	}
+
+	m_tilemaps[layer].tilemap->setTiles(tiles);
+	m_tilemaps[layer].tileCount = count;
+
+	if (layer == m_tilemaps.size() - 1 && count == 0)
+	{
+		while (m_tilemaps.size() > 0 && m_tilemaps.back().tileCount == 0)
+		{
+			m_event.send(LayerChanged{ m_tilemaps.size() - 1, LayerChanged::ChangeState::removed });
+			m_tilemaps.pop_back();
+		}
+	}
+}
+
 TilemapRef Chunk::getMap(size_t layer)
 {
 	if (!haveLayer(layer))
@@ -100,4 +142,12 @@ bool Chunk::tilesEqual(const Tile & t1, const Tile & t2)
 		return true;
 
 	return t1.collider.toInt() == t2.collider.toInt();
+}
+
+TilemapRef Chunk::createTilemap()
+{
+	//a setTile can update the render of the neighbour chunks, the events are sent once per frame
+	auto tilemap = Tilemap::New(chunkSize, chunkSize, tileSize, tileDelta);
+	tilemap->setQueuedEvents(true);
+	return tilemap;
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+
+#include "GameData/GenerationRules.h"
+#include "GameData/Chunk.h"
+#include "Utility/Perlin.h"
+#include "Utility/Simplex.h"
+#include "Utility/Expression/ExpressionParser.h"
+
+#include <map>
+#include <set>
+#include <memory>
+#include <cassert>
+
+namespace
+{
+	const size_t tileCount = Chunk::chunkSize * Chunk::chunkSize;
+
+	using Column = std::vector<float>;
+
+	//the parameter "parameter" of an expression reads the column "column"
+	struct Binding
+	{
+		size_t parameter;
+		size_t column;
+	};
+
+	struct CompiledExpression
+	{
+		NExpression::Expression<float> expression;
+		std::vector<Binding> bindings;
+	};
+
+	struct CompiledMaterial
+	{
+		unsigned int id;
+		size_t layer;
+		CompiledExpression condition;
+	};
+
+	/* colonnes : 0 = x, 1 = y, puis les bruits, puis les variables
+	 * tout est calcule colonne par colonne sur les chunkSize * chunkSize tiles du chunk
+	 * */
+	struct GenerationProgram
+	{
+		std::vector<Perlin2D> perlins;
+		std::vector<size_t> perlinColumns;
+		std::vector<Simplex> simplexs;
+		std::vector<size_t> simplexColumns;
+
+		std::vector<CompiledExpression> variables;
+		std::vector<size_t> variableColumns;
+
+		std::vector<CompiledMaterial> materials;
+
+		size_t columnCount = 2;
+		size_t layerCount = 0;
+	};
+
+	CompiledExpression compileExpression(NExpression::ExpressionParser<float> & parser, const std::string & str, const std::map<std::string, size_t> & columns)
+	{
+		CompiledExpression compiled;
+		compiled.expression = parser.evaluate(str);
+
+		const auto & names = compiled.expression.parameterNames();
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			auto it = columns.find(names[i]);
+			assert(it != columns.end() && "Unknown noise or variable in the generation rules");
+			if (it != columns.end())
+				compiled.bindings.push_back(Binding{ i, it->second });
+		}
+
+		return compiled;
+	}
+
+	//the whole column at once, out must hold tileCount values
+	void computeColumn(const CompiledExpression & e, const std::vector<Column> & columns, float * out)
+	{
+		std::vector<const float *> parameters(e.expression.parameterNames().size(), nullptr);
+		for (const auto & b : e.bindings)
+			parameters[b.parameter] = columns[b.column].data();
+		e.expression.computeBatch(parameters.data(), tileCount, out);
+	}
+
+	void generateChunk(const GenerationProgram & program, size_t chunkX, size_t chunkY, WorldGenerator::ChunkLayers & layers)
+	{
+		std::vector<Column> columns(program.columnCount, Column(tileCount));
+
+		for (size_t i = 0; i < tileCount; i++)
+		{
+			columns[0][i] = static_cast<float>(chunkX * Chunk::chunkSize + i % Chunk::chunkSize);
+			columns[1][i] = static_cast<float>(chunkY * Chunk::chunkSize + i / Chunk::chunkSize);
+		}
+
+		for (size_t n = 0; n < program.perlins.size(); n++)
+		{
+			auto & out = columns[program.perlinColumns[n]];
+			for (size_t i = 0; i < tileCount; i++)
+				out[i] = program.perlins[n](columns[0][i], columns[1][i]);
+		}
+
+		for (size_t n = 0; n < program.simplexs.size(); n++)
+			program.simplexs[n](columns[0].data(), columns[1].data(), columns[program.simplexColumns[n]].data(), tileCount);
+
+		//the expressions keep their evaluation buffers, each chunk works on its own copy
+		auto variables = program.variables;
+		for (size_t n = 0; n < variables.size(); n++)
+			computeColumn(variables[n], columns, columns[program.variableColumns[n]].data());
+
+		layers.assign(program.layerCount, Matrix<Tile>(Chunk::chunkSize, Chunk::chunkSize));
+		std::vector<std::vector<bool>> assigned(program.layerCount, std::vector<bool>(tileCount, false));
+
+		auto materials = program.materials;
+		Column conditions(tileCount);
+		for (auto & m : materials)
+		{
+			auto & layer = layers[m.layer];
+			auto & layerAssigned = assigned[m.layer];
+			computeColumn(m.condition, columns, conditions.data());
+			for (size_t i = 0; i < tileCount; i++)
+			{
+				if (layerAssigned[i])
+					continue;
+				if (conditions[i] == 0)
+					continue;
+				layerAssigned[i] = true;
+				layer(i % Chunk::chunkSize, i / Chunk::chunkSize) = Tile{ m.id, 0 };
+			}
+		}
+	}
+}
+
+void GenerationRules::addNoise(const Noise & noise)
+{
+	m_noises.push_back(noise);
+}
+
+void GenerationRules::addNoise(const std::string & name, NoiseType type, float amplitude, size_t frequence, size_t seed)
+{
+	Noise noise;
+	noise.name = name;
+	noise.type = type;
+	noise.amplitude = amplitude;
+	noise.frequence = frequence;
+	noise.seed = seed;
+	addNoise(noise);
+}
+
+void GenerationRules::addVariable(const std::string & name, const std::string & expression)
+{
+	m_variables.push_back(Variable{ name, expression });
+}
+
+void GenerationRules::addMaterial(unsigned int id, size_t layer, const std::string & condition)
+{
+	m_materials.push_back(Material{ id, layer, condition });
+}
+
+bool GenerationRules::check(std::string & error) const
+{
+	std::set<std::string> names{ "x", "y" };
+	for (const auto & n : m_noises)
+		names.insert(n.name);
+
+	NExpression::ExpressionParser<float> parser;
+	auto checkExpression = [&](const std::string & owner, const std::string & str)
+	{
+		try
+		{
+			auto expression = parser.evaluate(str);
+			for (const auto & name : expression.parameterNames())
+			{
+				if (names.find(name) != names.end())
+					continue;
+				error = owner + " : unknown noise or variable \"" + name + "\"";
+				return false;
+			}
+		}
+		catch (const NExpression::ParseError & e)
+		{
+			error = owner + " : " + e.what();
+			return false;
+		}
+		return true;
+	};
+
+	for (const auto & v : m_variables)
+	{
+		if (!checkExpression("variable " + v.name, v.expression))
+			return false;
+		names.insert(v.name);
+	}
+
+	for (const auto & m : m_materials)
+		if (!checkExpression("material " + std::to_string(m.id), m.condition))
+			return false;
+
+	return true;
+}
+
+WorldGenerator::GenerationFunction GenerationRules::compile(size_t worldSize) const
+{
+	auto program = std::make_shared<GenerationProgram>();
+
+	std::map<std::string, size_t> columns;
+	columns.emplace("x", 0);
+	columns.emplace("y", 1);
+
+	for (const auto & n : m_noises)
+	{
+		auto column = program->columnCount++;
+		columns[n.name] = column;
+
+		if (n.type == NoiseType::Perlin)
+		{
+			program->perlins.emplace_back(worldSize, n.amplitude, n.frequence, n.seed);
+			program->perlinColumns.push_back(column);
+		}
+		else
+		{
+			program->simplexs.emplace_back(worldSize, n.amplitude, n.frequence, n.seed);
+			program->simplexColumns.push_back(column);
+		}
+	}
+
+	NExpression::ExpressionParser<float> parser;
+
+	for (const auto & v : m_variables)
+	{
+		program->variables.push_back(compileExpression(parser, v.expression, columns));
+		auto column = program->columnCount++;
+		program->variableColumns.push_back(column);
+		columns[v.name] = column;
+	}
+
+	for (const auto & m : m_materials)
+	{
+		program->materials.push_back(CompiledMaterial{ m.id, m.layer, compileExpression(parser, m.condition, columns) });
+		program->layerCount = std::max(program->layerCount, m.layer + 1);
+	}
+
+	std::shared_ptr<const GenerationProgram> constProgram = program;
+	return [constProgram](size_t chunkX, size_t chunkY, WorldGenerator::ChunkLayers & layers)
+	{
+		generateChunk(*constProgram, chunkX, chunkY, layers);
+	};
+}
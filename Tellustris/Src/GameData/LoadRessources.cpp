@@ -129,7 +129,7 @@ bool RessourceLoader::loadAnimation(const std::string & path, const std::string
 	assert(j.is_object());
 
 	auto anim = Animation::New();
-	anim->loop = j["loop"].get<bool>();
+	anim->setLoop(j["loop"].get<bool>());
 
 	for (const auto jFrame : j["frames"])
 	{
@@ -5,6 +5,7 @@
 #include "Utility/Json.h"
 #include "GameData/TileDefinition.h"
 #include "GameData/CollisionDefinition.h"
+#include "GameData/GenerationRules.h"
 #include "GameData/LoadRessources.h"
 
 #include <filesystem>
@@ -23,6 +24,7 @@ void SettingsLoader::unloadAll()
 {
 	Settings<TileDefinition>::reset();
 	Settings<CollisionDefinition>::reset();
+	Settings<GenerationRules>::reset();
 }
 
 void SettingsLoader::loadDirectoryRessources(const std::string & basePath, const std::string & subPath)
@@ -57,6 +59,8 @@ void SettingsLoader::loadFile(const std::string & path, const std::string & file
 		loaded = loadTileDefinition(path, filename);
 	if (extension == "cdef")
 		loaded = loadCollisionDefinition(path, filename);
+	if (extension == "gdef")
+		loaded = loadGenerationRules(path, filename);
 
 	if (loaded)
 		std::cout << "Ressource " << filename << " loaded !" << std::endl;
@@ -168,5 +172,68 @@ bool SettingsLoader::loadCollisionDefinition(const std::string & path, const std
 
 	Settings<CollisionDefinition>::set(filename, def);
 
+	return true;
+}
+
+/* {
+ *   "noises" : [ { "name" : "ground", "type" : "perlin" or "simplex", "amplitude" : 0.5, "frequence" : 5, "seed" : 5 } ],
+ *   "variables" : [ { "name" : "height", "value" : "ground + 0.1" } ],
+ *   "materials" : [ { "id" : 1, "layer" : 0, "condition" : "(height < 0)" } ]
+ * }
+ * */
+bool SettingsLoader::loadGenerationRules(const std::string & path, const std::string & filename)
+{
+	if (Settings<GenerationRules>::value().IsValid())
+		return false;
+
+	Json j = Json::parse(RessourceLoader::readFile(path));
+
+	assert(j.is_object());
+
+	auto rules = GenerationRules::New();
+
+	const auto & noises = j["noises"];
+	assert(noises.is_array());
+	for (const auto & n : noises)
+	{
+		assert(n.is_object());
+		GenerationRules::Noise noise;
+		noise.name = n["name"].get<std::string>();
+		noise.type = n["type"].get<std::string>() == "simplex" ? GenerationRules::NoiseType::Simplex : GenerationRules::NoiseType::Perlin;
+		noise.amplitude = n["amplitude"].get<float>();
+		noise.frequence = n["frequence"].get<size_t>();
+		noise.seed = n["seed"].get<size_t>();
+		rules->addNoise(noise);
+	}
+
+	auto variables = j.find("variables");
+	if (variables != j.end())
+	{
+		assert(variables->is_array());
+		for (const auto & v : *variables)
+		{
+			assert(v.is_object());
+			rules->addVariable(v["name"].get<std::string>(), v["value"].get<std::string>());
+		}
+	}
+
+	const auto & materials = j["materials"];
+	assert(materials.is_array());
+	for (const auto & m : materials)
+	{
+		assert(m.is_object());
+		auto layer = m.find("layer");
+		rules->addMaterial(m["id"].get<unsigned int>(), layer == m.end() ? 0 : layer->get<size_t>(), m["condition"].get<std::string>());
+	}
+
+	std::string error;
+	if (!rules->check(error))
+	{
+		std::cout << "ERROR: " << filename << " : " << error << std::endl;
+		return false;
+	}
+
+	Settings<GenerationRules>::set(filename, rules);
+
 	return true;
 }
\ No newline at end of file
@@ -0,0 +1,22 @@
+
+#include "GameData/WorldGenerator.h"
+
+WorldGenerator::WorldGenerator(GenerationFunction function, ThreadPool & pool)
+	: m_function(std::move(function))
+	, m_pool(pool)
+{
+
+}
+
+std::vector<WorldGenerator::ChunkLayers> WorldGenerator::generate(const std::vector<Nz::Vector2ui> & chunks) const
+{
+	std::vector<ChunkLayers> layers(chunks.size());
+
+	//each task only writes its own element, no synchronisation needed
+	m_pool.parallelFor(chunks.size(), [this, &chunks, &layers](size_t i)
+	{
+		m_function(chunks[i].x, chunks[i].y, layers[i]);
+	});
+
+	return layers;
+}
@@ -5,6 +5,7 @@
 WorldMap::WorldMap(size_t chunksX, size_t chunksY)
 	: m_width(chunksX)
 	, m_height(chunksY)
+	, m_generated(chunksX * chunksY, false)
 {
 	m_chunks.reserve(chunksX * chunksY);
 
@@ -22,6 +23,8 @@ const Chunk & WorldMap::getChunk(int x, int y) const
 Chunk & WorldMap::getChunk(int x, int y) 
 {
 	auto pos = worldToLocalChunkPos(x, y);
+	if (m_generator && !m_generated[coordToChunkIndex(pos.x, pos.y)])
+		generateChunks({ Nz::Vector2i(x, y) });
 	return *m_chunks[coordToChunkIndex(pos.x, pos.y)];
 }
 
@@ -35,10 +38,11 @@ Tile WorldMap::getTile(int x, int y, size_t layer) const
 
 void WorldMap::setTile(int x, int y, Tile tile, size_t layer)
 {
-	auto chunkPos = posToChunkPos(x, y);
+	auto chunkPos = posToWorldChunkPos(x, y);
 	auto tilePos = posToTilePos(x, y);
 
-	m_chunks[coordToChunkIndex(chunkPos.x, chunkPos.y)]->setTile(tilePos.x, tilePos.y, tile, layer);
+	//non const getChunk, a tile set on a chunk not generated yet must not be overwriten by the generation
+	getChunk(chunkPos.x, chunkPos.y).setTile(tilePos.x, tilePos.y, tile, layer);
 }
 
 Matrix<Tile> WorldMap::getTiles(int x, int y, int width, int height, size_t layer) const
@@ -93,6 +97,60 @@ Matrix<Tile> WorldMap::getTiles(int x, int y, int width, int height, size_t laye
 	return tiles;
 }
 
+void WorldMap::setGenerator(std::unique_ptr<WorldGenerator> generator)
+{
+	m_generator = std::move(generator);
+}
+
+bool WorldMap::isGenerated(int x, int y) const
+{
+	auto pos = worldToLocalChunkPos(x, y);
+	return m_generated[coordToChunkIndex(pos.x, pos.y)];
+}
+
+void WorldMap::generateChunks(const std::vector<Nz::Vector2i> & chunks)
+{
+	if (!m_generator)
+		return;
+
+	std::vector<Nz::Vector2ui> missingChunks;
+	for (const auto & c : chunks)
+	{
+		auto pos = worldToLocalChunkPos(c);
+		auto index = coordToChunkIndex(pos.x, pos.y);
+		if (m_generated[index])
+			continue;
+		m_generated[index] = true;
+		missingChunks.push_back(pos);
+	}
+
+	if (missingChunks.empty())
+		return;
+
+	auto layers = m_generator->generate(missingChunks);
+
+	for (size_t i = 0; i < missingChunks.size(); i++)
+	{
+		auto & chunk = *m_chunks[coordToChunkIndex(missingChunks[i].x, missingChunks[i].y)];
+		for (size_t layer = 0; layer < layers[i].size(); layer++)
+			chunk.setLayer(layer, layers[i][layer]);
+	}
+
+	m_event.send(ChunksGenerated{ std::move(missingChunks) });
+}
+
+void WorldMap::generateAll()
+{
+	std::vector<Nz::Vector2i> chunks;
+	chunks.reserve(m_width * m_height);
+
+	for (size_t y = 0; y < m_height; y++)
+		for (size_t x = 0; x < m_width; x++)
+			chunks.emplace_back(static_cast<int>(x), static_cast<int>(y));
+
+	generateChunks(chunks);
+}
+
 Nz::Vector2ui WorldMap::posToChunkPos(const Nz::Vector2f & pos) const
 {
 	return posToChunkPos(pos.x, pos.y);
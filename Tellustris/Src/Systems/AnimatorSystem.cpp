@@ -1,6 +1,10 @@
-
 #include "Systems/AnimatorSystem.h"
 #include "Components/AnimatorComponent.h"
+#include "Utility/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cassert>
 
 Ndk::SystemIndex AnimatorSystem::systemIndex;
 
@@ -11,8 +15,171 @@ AnimatorSystem::AnimatorSystem()
 
 void AnimatorSystem::OnUpdate(float elapsedTime)
 {
-	for (const Ndk::EntityHandle& entity : GetEntities())
+	//an animator or an animation was modified, the components compile their animator again
+	if (m_sourceRevision != CompiledAnimator::sourceRevision())
+	{
+		m_sourceRevision = CompiledAnimator::sourceRevision();
+		for (auto component : m_components)
+			component->updateMachine();
+	}
+
+	size_t count = m_components.size();
+	size_t blockCount = (count + blockSize - 1) / blockSize;
+
+	//the conditions calling rand or a user function are not thread safe, these slots are updated after the blocks
+	//they are listed first, a slot changing of state in a block isn't updated twice
+	m_impureSlots.clear();
+	for (size_t i = 0; i < count; i++)
+		if (m_frameCounts[i] != 0 && m_impureConditions[i])
+			m_impureSlots.push_back(i);
+
+	ThreadPool::global().parallelFor(blockCount, [this, count, elapsedTime](size_t block)
+	{
+		size_t begin = block * blockSize;
+		updateBlock(begin, std::min(begin + blockSize, count), elapsedTime);
+	});
+
+	for (auto slot : m_impureSlots)
+		updateFrame(slot);
+
+	//the sprites are not thread safe, and changing them invalidates their vertices
+	for (size_t i = 0; i < count; i++)
+	{
+		if (m_frameCounts[i] == 0 || m_shownFrames[i] == m_frames[i])
+			continue;
+		m_shownFrames[i] = m_frames[i];
+		m_components[i]->updateSprite(m_frames[i]);
+	}
+}
+
+void AnimatorSystem::OnEntityAdded(Ndk::Entity * entity)
+{
+	auto & component = entity->GetComponent<AnimatorComponent>();
+	size_t slot = m_components.size();
+
+	m_components.push_back(&component);
+	m_frameEnds.push_back(nullptr);
+	m_frameCounts.push_back(0);
+	m_durations.push_back(0);
+	m_loops.push_back(false);
+	m_speeds.push_back(1);
+	m_stateTimes.push_back(0);
+	m_animationTimes.push_back(0);
+	m_frames.push_back(0);
+	m_shownFrames.push_back(noFrame);
+	m_impureConditions.push_back(false);
+
+	component.m_slot.system = this;
+	component.m_slot.index = slot;
+	load(slot);
+}
+
+void AnimatorSystem::OnEntityRemoved(Ndk::Entity * entity)
+{
+	//a removed component is destroyed first, its destructor already freed its slot
+	if (!entity->HasComponent<AnimatorComponent>())
+		return;
+	removeComponent(entity->GetComponent<AnimatorComponent>());
+}
+
+void AnimatorSystem::removeComponent(AnimatorComponent & component)
+{
+	assert(component.m_slot.system == this);
+	size_t slot = component.m_slot.index;
+
+	store(slot);
+	component.m_slot.system = nullptr;
+
+	size_t last = m_components.size() - 1;
+	if (slot != last)
+	{
+		m_components[slot] = m_components[last];
+		m_frameEnds[slot] = m_frameEnds[last];
+		m_frameCounts[slot] = m_frameCounts[last];
+		m_durations[slot] = m_durations[last];
+		m_loops[slot] = m_loops[last];
+		m_speeds[slot] = m_speeds[last];
+		m_stateTimes[slot] = m_stateTimes[last];
+		m_animationTimes[slot] = m_animationTimes[last];
+		m_frames[slot] = m_frames[last];
+		m_shownFrames[slot] = m_shownFrames[last];
+		m_impureConditions[slot] = m_impureConditions[last];
+		m_components[slot]->m_slot.index = slot;
+	}
+
+	m_components.pop_back();
+	m_frameEnds.pop_back();
+	m_frameCounts.pop_back();
+	m_durations.pop_back();
+	m_loops.pop_back();
+	m_speeds.pop_back();
+	m_stateTimes.pop_back();
+	m_animationTimes.pop_back();
+	m_frames.pop_back();
+	m_shownFrames.pop_back();
+	m_impureConditions.pop_back();
+}
+
+void AnimatorSystem::updateBlock(size_t begin, size_t end, float elapsedTime)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		float delta = elapsedTime * m_speeds[i];
+		m_stateTimes[i] += delta;
+		float time = m_animationTimes[i] + delta;
+		if (m_loops[i])
+			time = std::fmod(time, m_durations[i]);
+		else time = std::min(time, m_durations[i]);
+		m_animationTimes[i] = time;
+	}
+
+	for (size_t i = begin; i < end; i++)
+		if (m_frameCounts[i] != 0 && !m_impureConditions[i])
+			updateFrame(i);
+}
+
+void AnimatorSystem::updateFrame(size_t slot)
+{
+	//a new state starts on its first frame, its slot is already reset by the component
+	if (m_components[slot]->updateTransitions(m_stateTimes[slot], m_animationTimes[slot]))
+		return;
+
+	m_frames[slot] = CompiledAnimator::frameIndex(m_frameEnds[slot], m_frameCounts[slot], m_animationTimes[slot]);
+}
+
+void AnimatorSystem::load(size_t slot)
+{
+	const auto & component = *m_components[slot];
+
+	if (component.m_machine)
 	{
-		entity->GetComponent<AnimatorComponent>().update(elapsedTime);
+		const auto & state = component.m_machine->state(component.m_currentState);
+		m_frameEnds[slot] = component.m_machine->frameEnds(state);
+		m_frameCounts[slot] = state.frameCount;
+		m_durations[slot] = state.duration;
+		m_loops[slot] = state.loop && state.duration > 0;
+		m_impureConditions[slot] = state.alwaysEvaluated;
 	}
+	else
+	{
+		m_frameEnds[slot] = nullptr;
+		m_frameCounts[slot] = 0;
+		m_durations[slot] = 0;
+		m_loops[slot] = false;
+		m_impureConditions[slot] = false;
+	}
+	m_speeds[slot] = component.m_speed;
+	m_stateTimes[slot] = component.m_stateTime;
+	m_animationTimes[slot] = component.m_animationTime;
+	m_frames[slot] = component.m_frame;
+	m_shownFrames[slot] = noFrame;
+}
+
+void AnimatorSystem::store(size_t slot)
+{
+	auto & component = *m_components[slot];
+
+	component.m_stateTime = m_stateTimes[slot];
+	component.m_animationTime = m_animationTimes[slot];
+	component.m_frame = m_frames[slot];
 }
\ No newline at end of file
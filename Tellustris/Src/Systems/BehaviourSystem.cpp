@@ -1,6 +1,11 @@
-
 #include "Systems/BehaviourSystem.h"
 #include "Components/BehaviourComponent.h"
+#include "Utility/Event/EventQueue.h"
+#include "Utility/ThreadPool.h"
+
+#include <algorithm>
+#include <typeinfo>
+#include <cassert>
 
 Ndk::SystemIndex BehaviourSystem::systemIndex;
 
@@ -11,8 +16,235 @@ BehaviourSystem::BehaviourSystem()
 
 void BehaviourSystem::OnUpdate(float elapsedTime)
 {
-	for (const Ndk::EntityHandle& entity : GetEntities())
+	//the queued events sent since the last update, the behaviours see the changes they describe
+	EventQueue::dispatch();
+
+	//onStart can attach behaviours, and add their component again
+	for (size_t i = 0; i < m_startingComponents.size(); i++)
+		m_startingComponents[i]->start();
+	m_startingComponents.clear();
+
+	m_updating = true;
+	auto & pool = ThreadPool::global();
+
+	for (auto & type : m_types)
+	{
+		if (!type.updates || type.threading != BehaviourThreading::entity)
+			continue;
+		const auto & behaviours = type.behaviours;
+		pool.parallelFor(behaviours.size(), [&behaviours, elapsedTime](size_t i)
+		{
+			behaviours[i]->onUpdate(elapsedTime);
+		}, grain);
+	}
+
+	if (m_batchesDirty)
+		buildAccessBatches();
+	for (size_t i = 0; i < m_batchCount; i++)
+	{
+		const auto & batch = m_batches[i];
+		//the types updated in sequence first, each one is a single task
+		pool.parallelFor(batch.sequentialTypes.size() + batch.behaviours.size(), [this, &batch, elapsedTime](size_t j)
+		{
+			if (j >= batch.sequentialTypes.size())
+			{
+				batch.behaviours[j - batch.sequentialTypes.size()]->onUpdate(elapsedTime);
+				return;
+			}
+			for (auto b : m_types[batch.sequentialTypes[j]].behaviours)
+				b->onUpdate(elapsedTime);
+		}, grain);
+	}
+
+	//can attach or detach behaviours, and register new types : no reference is kept over an onUpdate
+	//the behaviours attached here are started and updated on the next update, only the listed ones are updated
+	for (size_t t = 0, typeCount = m_types.size(); t < typeCount; t++)
+	{
+		if (!m_types[t].updates || m_types[t].threading != BehaviourThreading::mainThread)
+			continue;
+		for (size_t i = 0, count = m_types[t].behaviours.size(); i < count; i++)
+		{
+			auto b = m_types[t].behaviours[i];
+			if (b)
+				b->onUpdate(elapsedTime);
+		}
+	}
+
+	m_updating = false;
+	cleanTypes();
+}
+
+void BehaviourSystem::OnEntityAdded(Ndk::Entity * entity)
+{
+	auto & component = entity->GetComponent<BehaviourComponent>();
+	assert(!component.m_system);
+	component.m_system = this;
+
+	for (const auto & b : component.m_behaviours)
+		addBehaviour(component, *b);
+	if (component.m_haveNewBehaviours)
+		startLater(component);
+}
+
+void BehaviourSystem::OnEntityRemoved(Ndk::Entity * entity)
+{
+	//a removed component is destroyed first, ~BehaviourComponent already removed it from the system
+	if (!entity->HasComponent<BehaviourComponent>())
+		return;
+	removeComponent(entity->GetComponent<BehaviourComponent>());
+}
+
+void BehaviourSystem::addBehaviour(BehaviourComponent & component, Behaviour & behaviour)
+{
+	assert(behaviour.m_updateType == Behaviour::noUpdateType);
+
+	//two instances of the same type on an entity would be updated at the same time
+	auto threading = behaviour.m_threading;
+	if (threading == BehaviourThreading::entity)
+	{
+		for (const auto & b : component.m_behaviours)
+			if (b.get() != &behaviour && b->m_updateType != Behaviour::noUpdateType && m_types[b->m_updateType].threading == BehaviourThreading::entity
+				&& typeid(*b) == typeid(behaviour))
+			{
+				threading = BehaviourThreading::mainThread;
+				break;
+			}
+	}
+
+	auto key = std::make_pair(std::type_index(typeid(behaviour)), threading);
+	auto it = m_typeIndexs.find(key);
+	if (it == m_typeIndexs.end())
+	{
+		it = m_typeIndexs.emplace(key, m_types.size()).first;
+		m_types.emplace_back();
+		m_types.back().threading = threading;
+	}
+
+	auto & type = m_types[it->second];
+	behaviour.m_updateType = it->second;
+	if (!type.updates)
+	{
+		behaviour.m_updateIndex = notListed;
+		return;
+	}
+	behaviour.m_updateIndex = type.behaviours.size();
+	type.behaviours.push_back(&behaviour);
+	if (threading == BehaviourThreading::access)
+		m_batchesDirty = true;
+}
+
+void BehaviourSystem::removeBehaviour(Behaviour & behaviour)
+{
+	if (behaviour.m_updateType == Behaviour::noUpdateType)
+		return;
+
+	auto & type = m_types[behaviour.m_updateType];
+	size_t index = behaviour.m_updateIndex;
+	behaviour.m_updateType = Behaviour::noUpdateType;
+	if (index == notListed)
+		return;
+	if (type.threading == BehaviourThreading::access)
+		m_batchesDirty = true;
+
+	if (m_updating)
+	{
+		type.behaviours[index] = nullptr;
+		type.haveRemoved = true;
+		return;
+	}
+
+	auto last = type.behaviours.back();
+	type.behaviours[index] = last;
+	last->m_updateIndex = index;
+	type.behaviours.pop_back();
+}
+
+void BehaviourSystem::removeComponent(BehaviourComponent & component)
+{
+	assert(component.m_system == this);
+
+	for (const auto & b : component.m_behaviours)
+		removeBehaviour(*b);
+	m_startingComponents.erase(std::remove(m_startingComponents.begin(), m_startingComponents.end(), &component), m_startingComponents.end());
+	component.m_system = nullptr;
+}
+
+void BehaviourSystem::startLater(BehaviourComponent & component)
+{
+	m_startingComponents.push_back(&component);
+}
+
+void BehaviourSystem::buildAccessBatches()
+{
+	for (size_t i = 0; i < m_batchCount; i++)
+	{
+		m_batches[i].access.clear();
+		m_batches[i].behaviours.clear();
+		m_batches[i].sequentialTypes.clear();
+	}
+	m_batchCount = 0;
+	m_batchesDirty = false;
+
+	//first batch without conflict
+	auto place = [this](const BehaviourAccess & access) -> AccessBatch &
+	{
+		size_t batch = 0;
+		while (batch < m_batchCount && m_batches[batch].access.conflicts(access))
+			batch++;
+		if (batch == m_batchCount)
+		{
+			if (m_batches.size() == m_batchCount)
+				m_batches.emplace_back();
+			m_batchCount++;
+		}
+		m_batches[batch].access.merge(access);
+		return m_batches[batch];
+	};
+
+	for (size_t t = 0; t < m_types.size(); t++)
 	{
-		entity->GetComponent<BehaviourComponent>().update(elapsedTime);
+		const auto & type = m_types[t];
+		if (!type.updates || type.threading != BehaviourThreading::access)
+			continue;
+
+		//an instance writing a component conflicts with the other instances, one batch each would run them one by one anyway
+		bool sequential = std::any_of(type.behaviours.begin(), type.behaviours.end(), [](const Behaviour * b) { return b->m_access.conflicts(b->m_access); });
+		if (sequential)
+		{
+			BehaviourAccess access;
+			for (auto b : type.behaviours)
+				access.merge(b->m_access);
+			place(access).sequentialTypes.push_back(t);
+			continue;
+		}
+
+		for (auto b : type.behaviours)
+			place(b->m_access).behaviours.push_back(b);
+	}
+}
+
+void BehaviourSystem::cleanTypes()
+{
+	for (auto & type : m_types)
+	{
+		if (type.haveRemoved)
+		{
+			type.behaviours.erase(std::remove(type.behaviours.begin(), type.behaviours.end(), nullptr), type.behaviours.end());
+			for (size_t i = 0; i < type.behaviours.size(); i++)
+				type.behaviours[i]->m_updateIndex = i;
+			type.haveRemoved = false;
+		}
+
+		//all the instances have the same onUpdate, the type is never updated again
+		if (type.updates && !type.behaviours.empty() && !type.behaviours.front()->m_updateOverridden)
+		{
+			type.updates = false;
+			if (type.threading == BehaviourThreading::access)
+				m_batchesDirty = true;
+			for (auto b : type.behaviours)
+				b->m_updateIndex = notListed;
+			type.behaviours.clear();
+			type.behaviours.shrink_to_fit();
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "Tilemap/ColliderMerger.h"
+#include "Utility/Bits.h"
+
+#include <algorithm>
+#include <tuple>
+#include <cassert>
+
+ColliderMerger::ColliderMerger(size_t width, size_t height)
+{
+	resize(width, height);
+}
+
+void ColliderMerger::resize(size_t width, size_t height)
+{
+	m_width = width;
+	m_height = height;
+	m_rowSize = (width + rowBits - 1) / rowBits;
+
+	m_full.assign(m_rowSize * m_height, 0);
+	m_partials.resize(m_height);
+	for (auto & p : m_partials)
+		p.clear();
+}
+
+void ColliderMerger::clear()
+{
+	std::fill(m_full.begin(), m_full.end(), 0);
+	for (auto & p : m_partials)
+		p.clear();
+}
+
+void ColliderMerger::addTile(size_t x, size_t y, const TileCollider & collider)
+{
+	assert(x < m_width && y < m_height);
+
+	if (!collider.haveCollision())
+		return;
+
+	if (collider.haveFullCollision())
+		m_full[y * m_rowSize + x / rowBits] |= Row(1) << (x % rowBits);
+	else m_partials[y].push_back(PartialTile{ static_cast<unsigned int>(x), collider });
+}
+
+void ColliderMerger::removeTile(size_t x, size_t y)
+{
+	assert(x < m_width && y < m_height);
+
+	m_full[y * m_rowSize + x / rowBits] &= ~(Row(1) << (x % rowBits));
+	auto & partials = m_partials[y];
+	partials.erase(std::remove_if(partials.begin(), partials.end(), [x](const auto & p) { return p.x == x; }), partials.end());
+}
+
+bool ColliderMerger::haveTile(size_t x, size_t y) const
+{
+	assert(x < m_width && y < m_height);
+
+	if (haveFullTile(x, y))
+		return true;
+	const auto & partials = m_partials[y];
+	return std::any_of(partials.begin(), partials.end(), [x](const auto & p) { return p.x == x; });
+}
+
+bool ColliderMerger::empty() const
+{
+	return std::all_of(m_full.begin(), m_full.end(), [](Row r) { return r == 0; })
+		&& std::all_of(m_partials.begin(), m_partials.end(), [](const auto & p) { return p.empty(); });
+}
+
+bool ColliderMerger::haveFullTile(size_t x, size_t y) const
+{
+	assert(x < m_width && y < m_height);
+
+	return (m_full[y * m_rowSize + x / rowBits] >> (x % rowBits)) & 1;
+}
+
+void ColliderMerger::merge(std::vector<Nz::Collider2DRef> & colliders, const Nz::Vector2f & tileSize, size_t beginRow, size_t endRow) const
+{
+	m_rects.clear();
+	fullRects(m_rects, beginRow, endRow);
+	for (const auto & r : m_rects)
+		colliders.push_back(Nz::BoxCollider2D::New(Nz::Rectf(r.x * tileSize.x, r.y * tileSize.y, r.width * tileSize.x, r.height * tileSize.y)));
+
+	mergePartials(colliders, tileSize, beginRow, endRow);
+}
+
+void ColliderMerger::fullRects(std::vector<Nz::Recti> & rects, size_t beginRow, size_t endRow) const
+{
+	endRow = std::min(endRow, m_height);
+	if (beginRow >= endRow)
+		return;
+
+	m_rows.assign(m_full.begin() + beginRow * m_rowSize, m_full.begin() + endRow * m_rowSize);
+	size_t rowCount = endRow - beginRow;
+
+	for (size_t y = 0; y < rowCount; y++)
+	{
+		Row * row = m_rows.data() + y * m_rowSize;
+		for (size_t word = 0; word < m_rowSize; word++)
+		{
+			while (row[word] != 0)
+			{
+				//the run can continue in the next masks of the row
+				unsigned int x = lowestBit(row[word]);
+				size_t width = bitRunLength(row[word], x);
+				size_t lastWord = word;
+				while (x + width == (lastWord - word + 1) * rowBits && lastWord + 1 < m_rowSize && (row[lastWord + 1] & 1))
+				{
+					lastWord++;
+					width += bitRunLength(row[lastWord], 0);
+				}
+
+				auto runMask = [&](size_t w)
+				{
+					size_t first = w == word ? x : 0;
+					size_t end = std::min(x + width - (w - word) * rowBits, rowBits);
+					return bitRange(static_cast<unsigned int>(first), static_cast<unsigned int>(end - first));
+				};
+
+				size_t height = 1;
+				for (; y + height < rowCount; height++)
+				{
+					const Row * next = m_rows.data() + (y + height) * m_rowSize;
+					Row missing = 0;
+					for (size_t w = word; w <= lastWord; w++)
+					{
+						Row mask = runMask(w);
+						missing |= (next[w] & mask) ^ mask;
+					}
+					if (missing != 0)
+						break;
+				}
+
+				for (size_t j = 0; j < height; j++)
+				{
+					Row * r = m_rows.data() + (y + j) * m_rowSize;
+					for (size_t w = word; w <= lastWord; w++)
+						r[w] &= ~runMask(w);
+				}
+
+				rects.emplace_back(static_cast<int>(word * rowBits + x), static_cast<int>(beginRow + y), static_cast<int>(width), static_cast<int>(height));
+			}
+		}
+	}
+}
+
+void ColliderMerger::mergePartials(std::vector<Nz::Collider2DRef> & colliders, const Nz::Vector2f & tileSize, size_t beginRow, size_t endRow) const
+{
+	endRow = std::min(endRow, m_height);
+	m_shapes.clear();
+
+	for (size_t y = beginRow; y < endRow; y++)
+		for (const auto & p : m_partials[y])
+		{
+			//a full collider of another map layer already covers the tile
+			if (haveFullTile(p.x, y))
+				continue;
+
+			Nz::Rectf rect;
+			if (!p.collider.toRect(rect) || (rect.width < 1.f && rect.height < 1.f))
+			{
+				colliders.push_back(p.collider.toCollider(Nz::Vector2f(p.x * tileSize.x, y * tileSize.y), tileSize));
+				continue;
+			}
+
+			bool vertical = rect.height >= 1.f;
+			auto major = vertical ? p.x : static_cast<unsigned int>(y);
+			auto minor = vertical ? static_cast<unsigned int>(y) : p.x;
+			m_shapes.push_back(PartialShape{ p.collider.toInt(), major, minor, vertical, rect });
+		}
+
+	std::sort(m_shapes.begin(), m_shapes.end(), [](const auto & a, const auto & b)
+	{
+		return std::tie(a.vertical, a.value, a.major, a.minor) < std::tie(b.vertical, b.value, b.major, b.minor);
+	});
+
+	for (size_t i = 0; i < m_shapes.size();)
+	{
+		const auto & first = m_shapes[i];
+		size_t length = 1;
+		size_t j = i + 1;
+		//the same shape can be on several map layers
+		for (; j < m_shapes.size(); j++)
+		{
+			const auto & s = m_shapes[j];
+			if (s.vertical != first.vertical || s.value != first.value || s.major != first.major || s.minor > first.minor + length)
+				break;
+			length = s.minor - first.minor + 1;
+		}
+
+		Nz::Rectf rect = first.rect;
+		if (first.vertical)
+		{
+			rect.x += first.major;
+			rect.y = static_cast<float>(first.minor);
+			rect.height = static_cast<float>(length);
+		}
+		else
+		{
+			rect.x = static_cast<float>(first.minor);
+			rect.y += first.major;
+			rect.width = static_cast<float>(length);
+		}
+		colliders.push_back(Nz::BoxCollider2D::New(Nz::Rectf(rect.x * tileSize.x, rect.y * tileSize.y, rect.width * tileSize.x, rect.height * tileSize.y)));
+
+		i = j;
+	}
+}
\ No newline at end of file
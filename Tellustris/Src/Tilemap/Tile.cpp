@@ -1,5 +1,8 @@
 #include "Tilemap/Tile.h"
 
+#include <array>
+#include <cassert>
+
 TileCollider::TileCollider(unsigned int value)
 {
 	fromInt(value);
@@ -38,64 +41,115 @@ bool TileCollider::haveFullCollision() const
 	return type == TileColliderType::Full;
 }
 
-Nz::Collider2DRef TileCollider::toCollider(const Nz::Vector2f & pos, const Nz::Vector2f & size)
+Nz::Collider2DRef TileCollider::toCollider(const Nz::Vector2f & pos, const Nz::Vector2f & size) const
 {
 	if (type == TileColliderType::Empty)
 		return {};
 	if (type == TileColliderType::Full)
 		return Nz::BoxCollider2D::New(Nz::Rectf(pos.x, pos.y, size.x, size.y));
-	if (type == TileColliderType::Triangle)
+	//an unknown type read from a file has no prototype
+	if (type > TileColliderType::Max)
 	{
-		Nz::Vector2f data[3];
-		data[0] = { -0.5f, -0.5f };
-		data[1] = { 0.5f, -0.5f };
-		data[2] = { 0.5f, 0.5f };
-
-		transform(data, 3);
-		moveAndScale(data, 3, pos, size);
-		return Nz::ConvexCollider2D::New(Nz::SparsePtr<Nz::Vector2f>(data), 3);
+		assert(false);
+		return {};
 	}
-	if (type == TileColliderType::Half)
+
+	const auto & p = prototype(variant());
+	Nz::Vector2f data[4];
+	for (unsigned int i = 0; i < p.count; i++)
+		data[i] = Nz::Vector2f(pos.x + p.points[i].x * size.x, pos.y + p.points[i].y * size.y);
+
+	return Nz::ConvexCollider2D::New(Nz::SparsePtr<Nz::Vector2f>(data), p.count);
+}
+
+bool TileCollider::toRect(Nz::Rectf & rect) const
+{
+	if (type == TileColliderType::Empty || type == TileColliderType::Triangle)
+		return false;
+	if (type > TileColliderType::Max)
 	{
-		Nz::Vector2f data[4];
-		data[0] = { -0.5f, -0.5f };
-		data[1] = { 0.f, -0.5f };
-		data[2] = { 0.f, 0.5f };
-		data[3] = { -0.5f, 0.5f };
-
-		transform(data, 4);
-		moveAndScale(data, 4, pos, size);
-		return Nz::ConvexCollider2D::New(Nz::SparsePtr<Nz::Vector2f>(data), 4);
+		assert(false);
+		return false;
 	}
-	if (type == TileColliderType::Quarter)
+
+	//the rectangles are stored from a corner to the opposite one
+	const auto & p = prototype(variant());
+	rect = Nz::Rectf(p.points[0], p.points[2]);
+	return true;
+}
+
+const TileCollider::Prototype & TileCollider::prototype(unsigned int variant)
+{
+	constexpr unsigned int variantCount = (static_cast<unsigned int>(TileColliderType::Max) + 1) << 4;
+
+	static const std::array<Prototype, variantCount> prototypes = []()
 	{
-		Nz::Vector2f data[4];
-		data[0] = { -0.5f, -0.5f };
-		data[1] = { 0.f, -0.5f };
-		data[2] = { 0.f, 0.f };
-		data[3] = { -0.5f, 0.f };
-
-		transform(data, 4);
-		moveAndScale(data, 4, pos, size);
-		return Nz::ConvexCollider2D::New(Nz::SparsePtr<Nz::Vector2f>(data), 4);
+		std::array<Prototype, variantCount> p;
+		for (unsigned int i = 0; i < variantCount; i++)
+			p[i] = TileCollider(i).buildPrototype();
+		return p;
+	}();
+
+	assert(variant < variantCount);
+	return prototypes[variant];
+}
+
+unsigned int TileCollider::variant() const
+{
+	return toInt() & 0xFFFF;
+}
+
+TileCollider::Prototype TileCollider::buildPrototype() const
+{
+	Prototype p;
+	p.count = 0;
+
+	if (type == TileColliderType::Full)
+	{
+		p.count = 4;
+		p.points[0] = { -0.5f, -0.5f };
+		p.points[1] = { 0.5f, -0.5f };
+		p.points[2] = { 0.5f, 0.5f };
+		p.points[3] = { -0.5f, 0.5f };
 	}
-	if (type == TileColliderType::CentredHalf)
+	else if (type == TileColliderType::Triangle)
 	{
-		Nz::Vector2f data[4];
-		data[0] = { -0.25f, -0.5f };
-		data[1] = { 0.25f, -0.5f };
-		data[2] = { 0.25f, 0.5f };
-		data[3] = { -0.25f, 0.5f };
-
-		transform(data, 4);
-		moveAndScale(data, 4, pos, size);
-		return Nz::ConvexCollider2D::New(Nz::SparsePtr<Nz::Vector2f>(data), 4);
+		p.count = 3;
+		p.points[0] = { -0.5f, -0.5f };
+		p.points[1] = { 0.5f, -0.5f };
+		p.points[2] = { 0.5f, 0.5f };
 	}
-	assert(false);
-	return {};
+	else if (type == TileColliderType::Half)
+	{
+		p.count = 4;
+		p.points[0] = { -0.5f, -0.5f };
+		p.points[1] = { 0.f, -0.5f };
+		p.points[2] = { 0.f, 0.5f };
+		p.points[3] = { -0.5f, 0.5f };
+	}
+	else if (type == TileColliderType::Quarter)
+	{
+		p.count = 4;
+		p.points[0] = { -0.5f, -0.5f };
+		p.points[1] = { 0.f, -0.5f };
+		p.points[2] = { 0.f, 0.f };
+		p.points[3] = { -0.5f, 0.f };
+	}
+	else if (type == TileColliderType::CentredHalf)
+	{
+		p.count = 4;
+		p.points[0] = { -0.25f, -0.5f };
+		p.points[1] = { 0.25f, -0.5f };
+		p.points[2] = { 0.25f, 0.5f };
+		p.points[3] = { -0.25f, 0.5f };
+	}
+
+	transform(p.points, p.count);
+	moveAndScale(p.points, p.count, Nz::Vector2f(0, 0), Nz::Vector2f(1, 1));
+	return p;
 }
 
-void TileCollider::transform(Nz::Vector2f * data, unsigned int size)
+void TileCollider::transform(Nz::Vector2f * data, unsigned int size) const
 {
 	for (unsigned int i = 0; i < size; i++)
 	{
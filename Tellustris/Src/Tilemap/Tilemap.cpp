@@ -1,11 +1,19 @@
 #include "Tilemap/Tilemap.h"
 
+#include <algorithm>
+
 Tilemap::Tilemap(size_t width, size_t height, unsigned int tileSize, unsigned int tileDelta)
 	: m_matrix(width, height)
 	, m_tileSize(tileSize)
 	, m_tileDelta(tileDelta)
 {
-
+	m_event.setQueueKey([this](const TilemapModified & e)
+	{
+		//the parameters of the constructor hide width() and height()
+		if (e.x >= this->width() || e.y >= this->height())
+			return this->width() * this->height();
+		return e.x + e.y * this->width();
+	});
 }
 
 Tilemap::TileType Tilemap::getTile(size_t x, size_t y) const
@@ -20,6 +28,15 @@ void Tilemap::setTile(size_t x, size_t y, Tilemap::TileType value)
 	m_event.send({x, y});
 }
 
+void Tilemap::setTiles(const Matrix<TileType> & tiles)
+{
+	assert(tiles.width() == m_matrix.width() && tiles.height() == m_matrix.height());
+
+	std::copy(tiles.begin(), tiles.end(), m_matrix.begin());
+
+	m_event.send({ ~0u, ~0u });
+}
+
 void Tilemap::setTileSize(unsigned int size)
 {
 	assert(size > 0);
@@ -34,4 +51,9 @@ void Tilemap::setTileDelta(unsigned int delta)
 	m_tileDelta = delta;
 
 	m_event.send({~0u, ~0u});
+}
+
+void Tilemap::setQueuedEvents(bool queued)
+{
+	m_event.setQueued(queued);
 }
\ No newline at end of file
@@ -13,13 +13,19 @@ void TilemapAnimations::registerAnimation(unsigned int tileID, const TileAnimati
 {
 	assert(!animation.empty());
 
-	auto it = std::find_if(m_tileAnimations.begin(), m_tileAnimations.end(), [tileID](const auto & a) {return a.tileID == tileID; });
-	if (it != m_tileAnimations.end())
+	auto index = lookup(tileID);
+	if (index != noAnimation)
 	{
-		it->animation = animation;
-		it->expression = expression;
+		m_tileAnimations[index].animation = animation;
+		m_tileAnimations[index].expression = expression;
+	}
+	else
+	{
+		if (tileID >= m_indexs.size())
+			m_indexs.resize(tileID + 1, noAnimation);
+		m_indexs[tileID] = m_tileAnimations.size();
+		m_tileAnimations.push_back(TileAnimationInfo{ tileID, animation, expression });
 	}
-	else m_tileAnimations.push_back(TileAnimationInfo{ tileID, animation, expression });
 
 	m_event.send({});
 }
@@ -32,45 +38,48 @@ void TilemapAnimations::registerAnimation(unsigned int tileID, const TileAnimati
 
 void TilemapAnimations::removeAnimation(unsigned int tileID)
 {
-	auto it = std::find_if(m_tileAnimations.begin(), m_tileAnimations.end(), [tileID](const auto & a) {return a.tileID == tileID; });
-	if (it != m_tileAnimations.end())
+	auto index = lookup(tileID);
+	if (index == noAnimation)
+		return;
+
+	m_indexs[tileID] = noAnimation;
+	if (index != m_tileAnimations.size() - 1)
 	{
-		*it = m_tileAnimations.back();
-		m_tileAnimations.pop_back();
-		m_event.send({});
+		m_tileAnimations[index] = m_tileAnimations.back();
+		m_indexs[m_tileAnimations[index].tileID] = index;
 	}
+	m_tileAnimations.pop_back();
+	m_event.send({});
 }
 
 bool TilemapAnimations::haveAnimation(unsigned int tileID) const
 {
-	return std::find_if(m_tileAnimations.begin(), m_tileAnimations.end(), [tileID](const auto & a) {return a.tileID == tileID; }) != m_tileAnimations.end();
+	return lookup(tileID) != noAnimation;
+}
+
+size_t TilemapAnimations::lookup(unsigned int tileID) const
+{
+	if (tileID >= m_indexs.size())
+		return noAnimation;
+	return m_indexs[tileID];
 }
 
 TileAnimation TilemapAnimations::animation(unsigned int tileID) const
 {
 	assert(haveAnimation(tileID));
-	
-	auto it = std::find_if(m_tileAnimations.begin(), m_tileAnimations.end(), [tileID](const auto & a) {return a.tileID == tileID; });
-	assert(it != m_tileAnimations.end());
-	return it->animation;
+	return m_tileAnimations[lookup(tileID)].animation;
 }
 
-TileAnimationExpression TilemapAnimations::animationExpression(unsigned int tileID) const
+const TileAnimationExpression & TilemapAnimations::animationExpression(unsigned int tileID) const
 {
 	assert(haveAnimation(tileID));
-
-	auto it = std::find_if(m_tileAnimations.begin(), m_tileAnimations.end(), [tileID](const auto & a) {return a.tileID == tileID; });
-	assert(it != m_tileAnimations.end());
-	return it->expression;
+	return m_tileAnimations[lookup(tileID)].expression;
 }
 
 size_t TilemapAnimations::index(unsigned int tileID) const
 {
 	assert(haveAnimation(tileID));
-
-	auto it = std::find_if(m_tileAnimations.begin(), m_tileAnimations.end(), [tileID](const auto & a) {return a.tileID == tileID; });
-	assert(it != m_tileAnimations.end());
-	return std::distance(m_tileAnimations.begin(), it);
+	return lookup(tileID);
 }
 
 const TileAnimation & TilemapAnimations::animation(size_t index) const
@@ -79,6 +88,12 @@ const TileAnimation & TilemapAnimations::animation(size_t index) const
 	return m_tileAnimations[index].animation;
 }
 
+const TileAnimationExpression & TilemapAnimations::animationExpression(size_t index) const
+{
+	assert(index < m_tileAnimations.size());
+	return m_tileAnimations[index].expression;
+}
+
 void TilemapAnimations::setFrameTime(float time)
 {
 	m_frameTime = time;
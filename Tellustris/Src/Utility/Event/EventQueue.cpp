@@ -0,0 +1,62 @@
+#include "Utility/Event/EventQueue.h"
+
+#include <algorithm>
+#include <cassert>
+
+std::vector<EventQueue::QueuedEvent> EventQueue::m_events;
+std::vector<EventQueue::QueuedEvent> EventQueue::m_dispatchedEvents;
+std::vector<EventQueue::QueuedEvent> EventQueue::m_channels;
+bool EventQueue::m_dispatching = false;
+
+void EventQueue::push(void * event, DispatchFunction function)
+{
+	m_events.push_back({ event, function });
+}
+
+void EventQueue::remove(void * event)
+{
+	m_events.erase(std::remove_if(m_events.begin(), m_events.end(), [event](const auto & e) {return e.event == event; }), m_events.end());
+
+	//the event can be destroyed by a listener of an other event of the same dispatch
+	for (auto & e : m_dispatchedEvents)
+		if (e.event == event)
+			e.event = nullptr;
+}
+
+void EventQueue::addChannel(void * channel, DispatchFunction function)
+{
+	m_channels.push_back({ channel, function });
+}
+
+void EventQueue::removeChannel(void * channel)
+{
+	//only reset while dispatching, a receiver can destroy an other channel
+	for (auto & c : m_channels)
+		if (c.event == channel)
+			c.event = nullptr;
+	if (!m_dispatching)
+		m_channels.erase(std::remove_if(m_channels.begin(), m_channels.end(), [](const auto & c) {return !c.event; }), m_channels.end());
+}
+
+void EventQueue::dispatch()
+{
+	assert(!m_dispatching);
+	m_dispatching = true;
+
+	//the values posted by the workers, the receivers can send queued events
+	for (size_t i = 0; i < m_channels.size(); i++)
+		if (m_channels[i].event)
+			m_channels[i].function(m_channels[i].event);
+
+	while (!m_events.empty())
+	{
+		std::swap(m_events, m_dispatchedEvents);
+		for (const auto & e : m_dispatchedEvents)
+			if (e.event)
+				e.function(e.event);
+		m_dispatchedEvents.clear();
+	}
+
+	m_dispatching = false;
+	m_channels.erase(std::remove_if(m_channels.begin(), m_channels.end(), [](const auto & c) {return !c.event; }), m_channels.end());
+}
\ No newline at end of file
@@ -1,11 +1,13 @@
 
 #include "Utility/Event/Events.h"
 #include <iostream>
+#include <atomic>
 
+//getId can be called for the first time from a worker thread
 Id nextId()
 {
-	static Id i = 0;
-	return i++;
+	static std::atomic<Id> i = 0;
+	return i.fetch_add(1, std::memory_order_relaxed);
 }
 
 EventsImpl::EventsImpl(const std::function<void(const void*)> & _function)
@@ -0,0 +1,110 @@
+#include "Utility/MemoryPool.h"
+
+#include <algorithm>
+#include <new>
+#include <cassert>
+
+MemoryPool::MemoryPool(size_t objectSize)
+	: m_objectSize(std::max(objectSize, sizeof(void *)))
+	, m_objectsPerBlock(std::max<size_t>(blockBytes / m_objectSize, 1))
+{
+
+}
+
+MemoryPool::~MemoryPool()
+{
+	for (auto b : m_blocks)
+		::operator delete(b);
+}
+
+void * MemoryPool::allocate()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_freeList)
+	{
+		auto block = static_cast<char *>(::operator new(m_objectSize * m_objectsPerBlock));
+		m_blocks.push_back(block);
+
+		//chained from the end, the first slot of the block is given first
+		for (size_t i = m_objectsPerBlock; i > 0; i--)
+		{
+			void * slot = block + (i - 1) * m_objectSize;
+			*static_cast<void **>(slot) = m_freeList;
+			m_freeList = slot;
+		}
+	}
+
+	void * object = m_freeList;
+	m_freeList = *static_cast<void **>(object);
+
+	m_liveCount++;
+	m_highWaterMark = std::max(m_highWaterMark, m_liveCount);
+	return object;
+}
+
+void MemoryPool::deallocate(void * object)
+{
+	if (!object)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	assert(m_liveCount > 0);
+	*static_cast<void **>(object) = m_freeList;
+	m_freeList = object;
+	m_liveCount--;
+}
+
+MemoryPool::Statistics MemoryPool::statistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return { m_liveCount, m_highWaterMark, m_blocks.size() * m_objectsPerBlock };
+}
+
+MemoryPool * MemoryPool::forSize(size_t size)
+{
+	if (size > maxPooledSize)
+		return nullptr;
+
+	//never destroyed, see the comment of the class
+	static std::vector<MemoryPool *> * pools = []()
+	{
+		auto p = new std::vector<MemoryPool *>();
+		for (size_t s = granularity; s <= smallSizeMax; s += granularity)
+			p->push_back(new MemoryPool(s));
+		for (size_t s = smallSizeMax * 2; s <= maxPooledSize; s *= 2)
+			p->push_back(new MemoryPool(s));
+		return p;
+	}();
+
+	return (*pools)[sizeClass(size)];
+}
+
+void * MemoryPool::allocate(size_t size)
+{
+	auto pool = forSize(size);
+	if (!pool)
+		return ::operator new(size);
+	return pool->allocate();
+}
+
+void MemoryPool::deallocate(void * object, size_t size)
+{
+	auto pool = forSize(size);
+	if (!pool)
+		::operator delete(object);
+	else pool->deallocate(object);
+}
+
+size_t MemoryPool::sizeClass(size_t size)
+{
+	size = std::max<size_t>(size, 1);
+	if (size <= smallSizeMax)
+		return (size - 1) / granularity;
+
+	size_t index = smallSizeMax / granularity;
+	for (size_t s = smallSizeMax * 2; s < size; s *= 2)
+		index++;
+	return index;
+}
\ No newline at end of file
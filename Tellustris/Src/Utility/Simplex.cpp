@@ -0,0 +1,203 @@
+
+#include "Utility/Simplex.h"
+#include "Utility/RandomHash.h"
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+namespace
+{
+	//16 unit vectors, evenly spaced
+	const float gradients2D[16][2] =
+	{
+		{ 1.f, 0.f }, { 0.92388f, 0.38268f }, { 0.70711f, 0.70711f }, { 0.38268f, 0.92388f },
+		{ 0.f, 1.f }, { -0.38268f, 0.92388f }, { -0.70711f, 0.70711f }, { -0.92388f, 0.38268f },
+		{ -1.f, 0.f }, { -0.92388f, -0.38268f }, { -0.70711f, -0.70711f }, { -0.38268f, -0.92388f },
+		{ 0.f, -1.f }, { 0.38268f, -0.92388f }, { 0.70711f, -0.70711f }, { 0.92388f, -0.38268f },
+	};
+
+	//the 12 cube edges directions, 4 of them repeated to get a power of 2, normalized
+	const float gradients3D[16][3] =
+	{
+		{ 0.70711f, 0.70711f, 0.f }, { -0.70711f, 0.70711f, 0.f }, { 0.70711f, -0.70711f, 0.f }, { -0.70711f, -0.70711f, 0.f },
+		{ 0.70711f, 0.f, 0.70711f }, { -0.70711f, 0.f, 0.70711f }, { 0.70711f, 0.f, -0.70711f }, { -0.70711f, 0.f, -0.70711f },
+		{ 0.f, 0.70711f, 0.70711f }, { 0.f, -0.70711f, 0.70711f }, { 0.f, 0.70711f, -0.70711f }, { 0.f, -0.70711f, -0.70711f },
+		{ 0.70711f, 0.70711f, 0.f }, { 0.f, -0.70711f, 0.70711f }, { -0.70711f, 0.70711f, 0.f }, { 0.f, -0.70711f, -0.70711f },
+	};
+
+	//bring the sums of the kernels back to [-1;1]
+	const float scale2D = 10.9f;
+	const float scale3D = 44.f;
+
+	inline uint32_t hashCorner(uint32_t seed, int32_t i, int32_t j, int32_t k)
+	{
+		uint32_t h = seed + static_cast<uint32_t>(i) * 0x9E3779B1u + static_cast<uint32_t>(j) * 0x85EBCA77u + static_cast<uint32_t>(k) * 0xC2B2AE3Du;
+		h ^= h >> 16;
+		h *= 0x85EBCA6Bu;
+		h ^= h >> 13;
+		h *= 0xC2B2AE35u;
+		h ^= h >> 16;
+		return h;
+	}
+
+	//std::floor is a libm call without SSE4.1, this one stays inlined and vectorizable
+	inline float fastFloor(float value)
+	{
+		float t = static_cast<float>(static_cast<int32_t>(value));
+		return t > value ? t - 1.f : t;
+	}
+
+	inline float wrap(float value, float period, float invPeriod)
+	{
+		//the corners lie on multiples of 0.5, the rounding of invPeriod must not move them out of [0;period[
+		float w = value - period * fastFloor(value * invPeriod);
+		w = w >= period ? w - period : w;
+		return w < 0.f ? w + period : w;
+	}
+
+	//contribution of one corner, (cx, cy) is the corner position and (dx, dy) the offset of the sample from it
+	inline float corner2D(float cx, float cy, float dx, float dy, float periodX, float periodY, float invPeriodX, float invPeriodY, uint32_t seed)
+	{
+		float wx = wrap(cx, periodX, invPeriodX);
+		float wy = wrap(cy, periodY, invPeriodY);
+		auto i = static_cast<int32_t>(fastFloor(wx + 0.5f * wy + 0.5f));
+		auto j = static_cast<int32_t>(fastFloor(wy + 0.5f));
+		const float * g = gradients2D[hashCorner(seed, i, j, 0) & 15];
+
+		float w = std::max(0.8f - dx * dx - dy * dy, 0.f);
+		w *= w;
+		w *= w;
+		return w * (g[0] * dx + g[1] * dy);
+	}
+
+	inline float simplex2D(float x, float y, float periodX, float periodY, float invPeriodX, float invPeriodY, uint32_t seed)
+	{
+		//lattice space, the simplices are the 2 halves of each unit square
+		float u = x + 0.5f * y;
+		float iu = fastFloor(u);
+		float iv = fastFloor(y);
+		float fu = u - iu;
+		float fv = y - iv;
+		float o = fu >= fv ? 1.f : 0.f;
+
+		//corners back in input space
+		float x0 = iu - 0.5f * iv;
+		float y0 = iv;
+		float x1 = x0 + 1.5f * o - 0.5f;
+		float y1 = y0 + 1.f - o;
+		float x2 = x0 + 0.5f;
+		float y2 = y0 + 1.f;
+
+		float n = corner2D(x0, y0, x - x0, y - y0, periodX, periodY, invPeriodX, invPeriodY, seed)
+			+ corner2D(x1, y1, x - x1, y - y1, periodX, periodY, invPeriodX, invPeriodY, seed)
+			+ corner2D(x2, y2, x - x2, y - y2, periodX, periodY, invPeriodX, invPeriodY, seed);
+		return scale2D * n;
+	}
+
+	//(u, v, w) is the corner in lattice space
+	inline float corner3D(float u, float v, float w, float x, float y, float z, float period, float invPeriod, uint32_t seed)
+	{
+		float cx = 0.5f * (v + w - u);
+		float cy = 0.5f * (u + w - v);
+		float cz = 0.5f * (u + v - w);
+		float dx = x - cx;
+		float dy = y - cy;
+		float dz = z - cz;
+
+		float wx = wrap(cx, period, invPeriod);
+		float wy = wrap(cy, period, invPeriod);
+		float wz = wrap(cz, period, invPeriod);
+		auto i = static_cast<int32_t>(fastFloor(wy + wz + 0.5f));
+		auto j = static_cast<int32_t>(fastFloor(wx + wz + 0.5f));
+		auto k = static_cast<int32_t>(fastFloor(wx + wy + 0.5f));
+		const float * g = gradients3D[hashCorner(seed, i, j, k) & 15];
+
+		float t = std::max(0.5f - dx * dx - dy * dy - dz * dz, 0.f);
+		return t * t * t * (g[0] * dx + g[1] * dy + g[2] * dz);
+	}
+
+	inline float simplex3D(float x, float y, float z, float period, float invPeriod, uint32_t seed)
+	{
+		//lattice space u = y + z, v = x + z, w = x + y
+		float u = y + z;
+		float v = x + z;
+		float w = x + y;
+		float iu = fastFloor(u);
+		float iv = fastFloor(v);
+		float iw = fastFloor(w);
+		float fu = u - iu;
+		float fv = v - iv;
+		float fw = w - iw;
+
+		//the simplex is chosen by sorting the fractional parts, without branches
+		float uv = fu >= fv ? 1.f : 0.f;
+		float vw = fv >= fw ? 1.f : 0.f;
+		float uw = fu >= fw ? 1.f : 0.f;
+
+		float o1u = uv * uw;
+		float o1v = (1.f - uv) * vw;
+		float o1w = (1.f - uw) * (1.f - vw);
+		float o2u = uv + uw - uv * uw;
+		float o2v = (1.f - uv) + vw - (1.f - uv) * vw;
+		float o2w = (1.f - uw) + (1.f - vw) - (1.f - uw) * (1.f - vw);
+
+		float n = corner3D(iu, iv, iw, x, y, z, period, invPeriod, seed)
+			+ corner3D(iu + o1u, iv + o1v, iw + o1w, x, y, z, period, invPeriod, seed)
+			+ corner3D(iu + o2u, iv + o2v, iw + o2w, x, y, z, period, invPeriod, seed)
+			+ corner3D(iu + 1.f, iv + 1.f, iw + 1.f, x, y, z, period, invPeriod, seed);
+		return scale3D * n;
+	}
+}
+
+Simplex::Simplex(size_t size, float amplitude, size_t frequence, size_t seed)
+	: m_size(size)
+	, m_amplitude(amplitude)
+	, m_frequence(frequence)
+	, m_seed(static_cast<uint32_t>(RandomHash::hash(seed)))
+{
+	assert(size > 0);
+	assert(frequence > 0);
+
+	m_period = static_cast<float>(frequence);
+	m_periodY = static_cast<float>(frequence + (frequence & 1));
+	m_scaleX = m_period / size;
+	m_scaleY = m_periodY / size;
+}
+
+float Simplex::operator()(float x, float y) const
+{
+	return m_amplitude * simplex2D(x * m_scaleX, y * m_scaleY, m_period, m_periodY, 1.f / m_period, 1.f / m_periodY, m_seed);
+}
+
+float Simplex::operator()(float x, float y, float z) const
+{
+	return m_amplitude * simplex3D(x * m_scaleX, y * m_scaleX, z * m_scaleX, m_period, 1.f / m_period, m_seed);
+}
+
+void Simplex::operator()(const float * x, const float * y, float * out, size_t count) const
+{
+	const float scaleX = m_scaleX;
+	const float scaleY = m_scaleY;
+	const float period = m_period;
+	const float periodY = m_periodY;
+	const float invPeriod = 1.f / m_period;
+	const float invPeriodY = 1.f / m_periodY;
+	const float amplitude = m_amplitude;
+	const uint32_t seed = m_seed;
+
+	for (size_t i = 0; i < count; i++)
+		out[i] = amplitude * simplex2D(x[i] * scaleX, y[i] * scaleY, period, periodY, invPeriod, invPeriodY, seed);
+}
+
+void Simplex::operator()(const float * x, const float * y, const float * z, float * out, size_t count) const
+{
+	const float scale = m_scaleX;
+	const float period = m_period;
+	const float invPeriod = 1.f / m_period;
+	const float amplitude = m_amplitude;
+	const uint32_t seed = m_seed;
+
+	for (size_t i = 0; i < count; i++)
+		out[i] = amplitude * simplex3D(x[i] * scale, y[i] * scale, z[i] * scale, period, invPeriod, seed);
+}
@@ -0,0 +1,186 @@
+
+#include "Utility/ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t threadCount)
+	: m_pendingTasks(0)
+	, m_stop(false)
+{
+	//at least one queue, the caller of parallelFor runs the tasks if there is no worker
+	for (size_t i = 0; i < std::max<size_t>(threadCount, 1); i++)
+		m_workers.push_back(std::make_unique<Worker>());
+
+	for (size_t i = 0; i < threadCount; i++)
+		m_threads.emplace_back([this, i]() {run(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (auto & t : m_threads)
+		t.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> & function, size_t grain)
+{
+	assert(grain > 0);
+
+	if (count == 0)
+		return;
+
+	size_t blockCount = (count + grain - 1) / grain;
+	if (blockCount == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			function(i);
+		return;
+	}
+
+	//shared by the blocks of this call only, it lives on the caller stack until every block is done
+	struct Loop
+	{
+		std::atomic<size_t> remaining;
+		std::atomic<bool> failed;
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	} loop;
+	loop.remaining = blockCount;
+	loop.failed = false;
+
+	for (size_t block = 0; block < blockCount; block++)
+	{
+		size_t begin = block * grain;
+		size_t end = std::min(begin + grain, count);
+		push(block % m_workers.size(), [this, &function, &loop, begin, end]()
+		{
+			//the block is counted as done even if function throws, the caller would wait forever otherwise
+			struct BlockDone
+			{
+				ThreadPool & pool;
+				Loop & loop;
+				~BlockDone()
+				{
+					if (--loop.remaining > 0)
+						return;
+					//loop can be destroyed as soon as remaining reach 0, only the pool is used from here
+					std::lock_guard<std::mutex> lock(pool.m_sleepMutex);
+					pool.m_wake.notify_all();
+				}
+			} done{ *this, loop };
+
+			if (loop.failed)
+				return;
+
+			try
+			{
+				for (size_t i = begin; i < end; i++)
+					function(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(loop.errorMutex);
+				if (!loop.error)
+					loop.error = std::current_exception();
+				loop.failed = true;
+			}
+		});
+	}
+
+	//help the workers until our own blocks are done, the tasks we run can come from another parallelFor
+	//when there is nothing left to steal, sleep until a block finish or a new task is pushed
+	Task task;
+	while (loop.remaining > 0)
+	{
+		if (steal(m_workers.size(), task))
+		{
+			task();
+			task = {};
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this, &loop]() {return loop.remaining == 0 || m_pendingTasks > 0; });
+	}
+
+	if (loop.error)
+		std::rethrow_exception(loop.error);
+}
+
+ThreadPool & ThreadPool::global()
+{
+	static ThreadPool pool(std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1);
+	return pool;
+}
+
+void ThreadPool::push(size_t workerIndex, Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workers[workerIndex]->mutex);
+		m_workers[workerIndex]->tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_pendingTasks++;
+	}
+	m_wake.notify_one();
+}
+
+bool ThreadPool::pop(size_t workerIndex, Task & task)
+{
+	auto & worker = *m_workers[workerIndex];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.tasks.empty())
+		return false;
+
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	m_pendingTasks--;
+	return true;
+}
+
+bool ThreadPool::steal(size_t workerIndex, Task & task)
+{
+	//workerIndex can be out of range for a thread that isn't a worker, it steals from everyone
+	size_t count = m_workers.size();
+	for (size_t i = 1; i <= count; i++)
+	{
+		auto & worker = *m_workers[(workerIndex + i) % count];
+		std::unique_lock<std::mutex> lock(worker.mutex, std::try_to_lock);
+		if (!lock.owns_lock() || worker.tasks.empty())
+			continue;
+
+		task = std::move(worker.tasks.front());
+		worker.tasks.pop_front();
+		m_pendingTasks--;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run(size_t workerIndex)
+{
+	Task task;
+	while (true)
+	{
+		if (pop(workerIndex, task) || steal(workerIndex, task))
+		{
+			task();
+			task = {};
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this]() {return m_stop || m_pendingTasks > 0; });
+		if (m_stop)
+			return;
+	}
+}
@@ -14,6 +14,8 @@
 #include "GameData/Behaviours/WorldRenderBehaviour.h"
 #include "GameData/LoadRessources.h"
 #include "GameData/LoadSettings.h"
+#include "GameData/GenerationRules.h"
+#include "Utility/Settings.h"
 #include "Utility/Perlin.h"
 #include "Utility/enumiterators.h"
 
@@ -394,32 +396,34 @@ int main()
 		for (size_t i = 1; i <= 5; i++)
 			def->addAllowedLayers(i, 0, 1);
 
-		size_t size = chunkNb * Chunk::chunkSize;
-		Perlin2D perlinGround1(size, 1.f / 2, 5, 5);
-		Perlin2D perlinGround2(size, 1.f / 4, 10, 6);
-		Perlin2D perlinSand(size, 1.f, 5, 8);
+		//rules from the .gdef settings, the default ones are the original hand written world
+		GenerationRulesConstRef rules = Settings<GenerationRules>::value();
+		if (!rules.IsValid())
+		{
+			auto defaultRules = GenerationRules::New();
+			defaultRules->addNoise("ground1", GenerationRules::NoiseType::Perlin, 1.f / 2, 5, 5);
+			defaultRules->addNoise("ground2", GenerationRules::NoiseType::Perlin, 1.f / 4, 10, 6);
+			defaultRules->addNoise("sand", GenerationRules::NoiseType::Perlin, 1.f, 5, 8);
+			defaultRules->addVariable("height", "ground1 + ground2");
+			defaultRules->addVariable("isSand", "(sand > 0) && (abs(height) < 0.1)");
+			defaultRules->addMaterial(2, 0, "(height < 0) && isSand");
+			defaultRules->addMaterial(1, 0, "height < 0");
+			defaultRules->addMaterial(4, 0, "isSand");
+			defaultRules->addMaterial(5, 0, "1");
 
-		for(size_t x = 0 ; x < size ; x++)
-			for (size_t y = 0; y < size; y++)
+			//checked like the .gdef ones by the loader, compile only asserts on bad rules
+			std::string error;
+			if (!defaultRules->check(error))
 			{
-				unsigned int id = 0;
-				auto height = perlinGround1(x, y) + perlinGround2(x, y);
-				auto isSand = perlinSand(x, y) > 0 && std::abs(height) < 0.1f;
-
-				if (height < 0)
-				{
-					if (!isSand)
-						id = 1;
-					else id = 2;
-				}
-				else
-				{
-					if (!isSand)
-						id = 5;
-					else id = 4;
-				}
-				map.setTile(x, y, Tile{ id, 0 }, 0);
+				std::cout << "ERROR: default generation rules : " << error << std::endl;
+				SettingsLoader::unloadAll();
+				RessourceLoader::unloadAll();
+				return 1;
 			}
+			rules = defaultRules;
+		}
+
+		map.setGenerator(std::make_unique<WorldGenerator>(rules->compile(chunkNb * Chunk::chunkSize)));
 
 		mapEntity->AddComponent<Ndk::NodeComponent>();
 		auto & behaviour = mapEntity->AddComponent<BehaviourComponent>();